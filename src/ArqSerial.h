@@ -19,6 +19,14 @@ private:
 	RingBuffer<uint8_t, 32> DataBuffer;
 	IdleFunction idleFunction = 0;
 
+	// Link statistics, reported and cleared by X linkstats
+	uint16_t statPackets = 0;
+	uint32_t statBytes = 0;
+	uint16_t statNAcks[5] = { 0 };     // by reason 1-5
+	uint16_t statRxFull = 0;           // times the UART RX ring was found full
+	bool rxWasFull = false;
+	unsigned long lastRxMillis = 0;
+
 #ifdef TESTFAIL
 	int testfailidx = 0;
 	int testfailidx2 = 0;
@@ -32,6 +40,7 @@ private:
 			if (idleFunction != 0) idleFunction(true);
 			c = Serial.read();
 			if (c >= 0) {
+				lastRxMillis = millis();
 #ifdef TESTFAIL
 				testfailidx = (testfailidx + 1) % 5000;
 				if (testfailidx == 500)
@@ -51,6 +60,12 @@ private:
 		byte currentCrc;
 
 		while (Serial.available() > 0) {
+			// A full ring means HardwareSerial has been discarding bytes since it filled.
+			bool rxFull = Serial.available() >= SERIAL_RX_BUFFER_SIZE - 1;
+			if (rxFull && !rxWasFull && statRxFull < 0xFFFF)
+				statRxFull++;
+			rxWasFull = rxFull;
+
 			header = Arq_TimedRead();
 			//DebugPrintLn("hello1");
 			currentCrc = 0;
@@ -113,7 +128,10 @@ private:
 							DataBuffer.push(partialdatabuffer[i]);
 						}
 						Arq_LastValidPacket = packetID;
+						statBytes += length;
 					}
+					if (statPackets < 0xFFFF)
+						statPackets++;
 #ifdef TESTFAIL
 					testfailidx = (testfailidx + 1) % 5000;
 					if (testfailidx != 788) {
@@ -125,6 +143,8 @@ private:
 				}
 
 				if (reason > 0) {
+					if (statNAcks[reason - 1] < 0xFFFF)
+						statNAcks[reason - 1]++;
 					SendNAcq(Arq_LastValidPacket, reason);
 				}
 			}
@@ -152,6 +172,22 @@ public:
 		idleFunction = function;
 	}
 
+	// Link statistics. Every lost or corrupted byte ends in a NAck (1 = no packet id,
+	// 2 = bad length, 3 = no CRC, 4 = CRC mismatch, 5 = payload timeout) and a resend.
+	uint16_t packets() const { return statPackets; }
+	uint32_t payloadBytes() const { return statBytes; }
+	uint16_t nacks(uint8_t reason) const { return statNAcks[reason - 1]; }
+	uint16_t rxFullEvents() const { return statRxFull; }
+	unsigned long lastRx() const { return lastRxMillis; }
+
+	void resetStats() {
+		statPackets = 0;
+		statBytes = 0;
+		for (uint8_t i = 0; i < 5; i++)
+			statNAcks[i] = 0;
+		statRxFull = 0;
+	}
+
 	void CustomPacketStart(byte packetType, uint8_t length) {
 		Serial.write(0x09);
 		Serial.write(packetType);
@@ -184,6 +220,29 @@ public:
 		return -1;
 	}
 
+	// Bulk variant of read(): borrows up to max contiguous bytes of command data in place
+	// (ARQ packets are at most 32 bytes, so a span is too). Waits like read(); returns 0 on
+	// timeout. The bytes stay buffered until consume() releases them.
+	uint8_t peekSpan(const uint8_t*& span, uint8_t max) {
+		unsigned long fsr_startMillis = millis();
+		do {
+			if (idleFunction != 0) idleFunction(false);
+
+			if (DataBuffer.size() > 0) {
+				uint8_t n = DataBuffer.peekSpan(span);
+				return n < max ? n : max;
+			}
+
+			ProcessIncomingData();
+		} while (millis() - fsr_startMillis < 400);
+
+		return 0;
+	}
+
+	void consume(uint8_t count) {
+		DataBuffer.consume(count);
+	}
+
 	int Available() {
 		if (idleFunction != 0) idleFunction(false);
 		if (DataBuffer.size() == 0) {
@@ -251,6 +310,27 @@ public:
 		Serial.flush();
 	}
 
+	// Buffer variants (SHMessage): one frame, no String.
+	void PrintLn(const char* data, uint8_t len)
+	{
+		Serial.write(0x06);
+		Serial.write(len + 1);
+		Serial.write((const uint8_t*)data, len);
+		Serial.write('\n');
+		Serial.write(0x20);
+		Serial.flush();
+	}
+
+	void DebugPrintLn(const char* data, uint8_t len)
+	{
+		Serial.write(0x07);
+		Serial.write(len + 1);
+		Serial.write((const uint8_t*)data, len);
+		Serial.write('\n');
+		Serial.write(0x20);
+		Serial.flush();
+	}
+
 	void PrintLn() {
 		Write('\n');
 	}
@@ -280,6 +360,21 @@ public:
 		
 	}
 
+	// Bounded read into a caller buffer, NUL-terminated. Characters past size - 1 are
+	// consumed and dropped so the stream stays in step. Returns the stored length.
+	uint8_t ReadStringUntil(char buffer[], uint8_t size, char terminator1, char terminator2) {
+		uint8_t pos = 0;
+		int c = read();
+		while (c >= 0 && c != terminator1 && c != terminator2)
+		{
+			if (pos < size - 1)
+				buffer[pos++] = (char)c;
+			c = read();
+		}
+		buffer[pos] = 0;
+		return pos;
+	}
+
 	String ReadStringUntil(char terminator1) {
 		String ret;
 		int c = read();
@@ -1,5 +1,7 @@
 #pragma once
 #include <Arduino.h>
+#include <util/atomic.h>
+#include "SHClutchPWM.h" // CLUTCH_DUAL_PWM moves the SR data pin
 
 // Rotary switch analog input pins
 #define ROTARY_A0_PIN A0  // ROT1 — mode selector for encoder routing
@@ -14,7 +16,11 @@
 
 // 74HC595 shift register chain (9 chips, 72 bits)
 // Outputs feed into 74HC165 inputs on the Pro Micro (MMJoy2) HID side.
+#if CLUTCH_DUAL_PWM
+#define SR595_DATA_PIN   7  // DS    — serial data (D10 is OC1B in the dual-PWM variant)
+#else
 #define SR595_DATA_PIN  10  // DS    — serial data
+#endif
 #define SR595_CLOCK_PIN 11  // SH_CP — shift clock
 #define SR595_LATCH_PIN 12  // ST_CP — storage/latch clock
 #define SR595_OE_PIN     5  // /OE   — output enable (active LOW)
@@ -25,9 +31,9 @@
 //
 //   Bits  0-35 : ROT1 encoder outputs — ALL 12 positions × 3 (SW=0, CCW=1, CW=2).
 //                Formula: position N (1-based) → SW=bit(N-1)*3, CCW=bit(N-1)*3+1, CW=bit(N-1)*3+2
-//                SimHub-dedicated positions never set their bits (events go to serial only).
-//                Layout is FIXED regardless of which positions are currently SimHub-dedicated,
-//                so the Pro Micro button mapping never changes when SHP: config is updated.
+//                Positions whose route has no SR sink never set their bits (events go to serial only).
+//                Layout is FIXED regardless of the routing table contents,
+//                so the Pro Micro button mapping never changes when SHP: / X route config is updated.
 //
 //   Bits 36-47 : ROT2 one-hot (bit 36+pos-1 HIGH for active position 1-12)
 //   Bits 48-59 : ROT3 one-hot (bit 48+pos-1)
@@ -55,6 +61,30 @@
 // Duration (ms) that CCW/CW encoder event bits are held HIGH in the shift register
 #define ENCODER_SR_PULSE_MS 30
 
+// ROT1 routing table — one packed byte per position (index = position - 1).
+//
+//   bits 0-1 : sink         — SR (Pro Micro via 74HC595), SimHub (serial), both, or none (muted)
+//   bits 2-5 : SimHub slot  — 0-11, SimHub button IDs 100+slot*3 (SW), +1 (CCW), +2 (CW)
+//   bits 6-7 : encoder mode — normal, reversed (CCW/CW swapped), or SW only (rotation ignored)
+//
+// The SR bit base is not stored: it is always (pos-1)*3 so the fixed 74HC595 layout above holds.
+// Default table = SR everywhere except positions 8/9/10 → SimHub slots 0/1/2 (same as SHP:8,9,10).
+#define ROT1_POSITIONS           12
+#define ROUTE_SINK_MASK          0x03
+#define ROUTE_SINK_SR            0x01
+#define ROUTE_SINK_SIMHUB        0x02
+#define ROUTE_SLOT_SHIFT         2
+#define ROUTE_SLOT_MASK          0x3C
+#define ROUTE_MODE_SHIFT         6
+#define ROUTE_MODE_MASK          0xC0
+#define ROUTE_MODE_NORMAL        0x00
+#define ROUTE_MODE_REVERSED      0x40
+#define ROUTE_MODE_SW_ONLY       0x80
+#define ROUTE_SIMHUB_BUTTON_BASE 100
+
+#define ROUTE_SR                     ROUTE_SINK_SR
+#define ROUTE_SIMHUB(slot)           (uint8_t)(ROUTE_SINK_SIMHUB | ((slot) << ROUTE_SLOT_SHIFT))
+
 // Rotary encoder half-step state machine (exact copy from SimHub's SHRotaryEncoder.h)
 #define R_START       0x0
 #define DIR_CW        0x10
@@ -75,45 +105,34 @@ static const unsigned char expandedInputsHalfStepsTable[6][4] = {
     {HS_R_START_M,            HS_R_CCW_BEGIN_M, HS_R_START_M,     R_START | DIR_CCW},
 };
 
-// ADC thresholds for 12-position resistor-ladder rotary switches.
-// All four rotaries use the same 2.7kΩ ladder network (R1–R14).
-// Position 1-12 maps to indices 0-11. Each value is the midpoint
-// between adjacent measured ADC levels (step ≈85, noise ≤3 counts).
-const int ROTARY_THRESHOLDS[12] = {
-    126,  // pos  1 — ADC ~84
-    211,  // pos  2 — ADC ~169
-    296,  // pos  3 — ADC ~254
-    380,  // pos  4 — ADC ~339
-    465,  // pos  5 — ADC ~423
-    549,  // pos  6 — ADC ~507
-    634,  // pos  7 — ADC ~592
-    719,  // pos  8 — ADC ~677
-    805,  // pos  9 — ADC ~762
-    891,  // pos 10 — ADC ~848
-    979,  // pos 11 — ADC ~935
-   1023,  // pos 12 — ADC ~1023
-};
+#include "InputSnapshot.h"
+
+// ADC decoding for the 12-position resistor-ladder rotary switches.
+// All four rotaries use the same 2.7kΩ ladder network (R1–R14). Position thresholds are
+// learned per channel on-device and persisted to EEPROM — see SHRotaryLadder.h.
+#include "SHRotaryLadder.h"
 
 class ExpandedInputsPreProcessor
 {
 private:
-    // SimHub-dedicated encoder positions (configurable via SHP: protocol token).
-    // Default {8,9,10} — events for these 3 positions are sent to SimHub via serial;
-    // events for all other 9 positions are routed to the Pro Micro via 74HC595.
-    uint8_t _simhubPositions[3] = {8, 9, 10};
+    // ROT1 routing table (see ROUTE_* layout above). Rebuilt from SHP: or replaced
+    // wholesale by the X route command; read with one indexed load per encoder edge.
+    uint8_t _routeTable[ROT1_POSITIONS] = {
+        ROUTE_SR, ROUTE_SR, ROUTE_SR, ROUTE_SR, ROUTE_SR, ROUTE_SR, ROUTE_SR,
+        ROUTE_SIMHUB(0), ROUTE_SIMHUB(1), ROUTE_SIMHUB(2),
+        ROUTE_SR, ROUTE_SR,
+    };
+
+    // Per-channel learned ladder levels / thresholds (channel 0-3 = A0-A3)
+    SHRotaryLadder _ladder;
 
     // ROT1 state (mode selector for encoder routing)
     int lastRotaryPosition = -1;
-    unsigned long lastRotaryRead = 0;
-    const unsigned long ROTARY_READ_INTERVAL = 10; // ms
 
     // ROT2/3/4 state (simple rotaries — one-hot SR output)
     int lastRotary2Position = -1;
     int lastRotary3Position = -1;
     int lastRotary4Position = -1;
-    unsigned long lastRotary2Read = 0;
-    unsigned long lastRotary3Read = 0;
-    unsigned long lastRotary4Read = 0;
 
     // Rotary encoder state machine
     uint8_t encoderLastState = R_START;
@@ -124,25 +143,62 @@ private:
     // SW button debounce state
     bool lastSWRawState      = false;
     bool lastSWReportedState = false;
-    int  lastSWButtonId      = -1;   // stores baseButtonId (≥100 = SimHub, else = SR bit for SW)
+    uint8_t lastSWRoute      = 0;    // route byte the current SW press was emitted on
+    uint8_t lastSWSrBase     = 0xFF; // SR base of that position (0xFF = no press emitted yet)
     unsigned long lastSWChangeTime = 0;
     const unsigned long SW_DEBOUNCE_DELAY = 50; // ms
 
     // 74HC595 output state buffer (72 bits across 9 bytes)
     uint8_t _srState[SR_CHIP_COUNT] = {};
+    bool _srDirty = false; // _srState differs from the latched outputs; cleared by commitSr()
 
     // Active CCW/CW encoder SR pulse tracker (only one pulse active at a time)
     int8_t _activePulseBit = -1;
     unsigned long _pulseStartTime = 0;
 
+    // Output registers of the 74HC595 pins, resolved once in begin() so writeAllTo595()
+    // can bit-bang the chain from the input-plane tick.
+    volatile uint8_t* _srDataPort  = nullptr;
+    volatile uint8_t* _srClockPort = nullptr;
+    volatile uint8_t* _srLatchPort = nullptr;
+    uint8_t _srDataMask  = 0;
+    uint8_t _srClockMask = 0;
+    uint8_t _srLatchMask = 0;
+
 public:
+    // Legacy SHP:p1,p2,p3 — rebuild the table as SR everywhere plus three SimHub slots.
     void setSimHubPositions(uint8_t p1, uint8_t p2, uint8_t p3)
     {
-        _simhubPositions[0] = p1;
-        _simhubPositions[1] = p2;
-        _simhubPositions[2] = p3;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) // the input-plane tick reads the table
+        {
+            for (uint8_t i = 0; i < ROT1_POSITIONS; i++)
+                _routeTable[i] = ROUTE_SR;
+            _routeTable[p1 - 1] = ROUTE_SIMHUB(0);
+            _routeTable[p2 - 1] = ROUTE_SIMHUB(1);
+            _routeTable[p3 - 1] = ROUTE_SIMHUB(2);
+        }
+    }
+
+    // Replace the whole routing table (X route). Rejects the update if any entry has an
+    // out-of-range slot or encoder mode, so a corrupt frame never half-applies.
+    bool setRoutingTable(const uint8_t table[ROT1_POSITIONS])
+    {
+        for (uint8_t i = 0; i < ROT1_POSITIONS; i++)
+        {
+            if (((table[i] & ROUTE_SLOT_MASK) >> ROUTE_SLOT_SHIFT) >= ROT1_POSITIONS)
+                return false;
+            if ((table[i] & ROUTE_MODE_MASK) > ROUTE_MODE_SW_ONLY)
+                return false;
+        }
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        {
+            memcpy(_routeTable, table, ROT1_POSITIONS);
+        }
+        return true;
     }
 
+    const uint8_t* getRoutingTable() const { return _routeTable; }
+
     void begin()
     {
         pinMode(ENCODER_CLK_PIN, INPUT_PULLUP);
@@ -152,6 +208,7 @@ public:
         lastSWReportedState = lastSWRawState;
         lastSWChangeTime    = millis();
         encoderLastState    = R_START;
+        _ladder.begin();
 
         // Safe 74HC595 startup:
         // Pre-load D5 HIGH *before* switching to OUTPUT — ATmega PORT register is 0x00 after
@@ -166,28 +223,67 @@ public:
         pinMode(SR595_DATA_PIN,  OUTPUT);
         pinMode(SR595_CLOCK_PIN, OUTPUT);
         pinMode(SR595_LATCH_PIN, OUTPUT);
+        _srDataPort  = portOutputRegister(digitalPinToPort(SR595_DATA_PIN));
+        _srClockPort = portOutputRegister(digitalPinToPort(SR595_CLOCK_PIN));
+        _srLatchPort = portOutputRegister(digitalPinToPort(SR595_LATCH_PIN));
+        _srDataMask  = digitalPinToBitMask(SR595_DATA_PIN);
+        _srClockMask = digitalPinToBitMask(SR595_CLOCK_PIN);
+        _srLatchMask = digitalPinToBitMask(SR595_LATCH_PIN);
         writeAllTo595(); // _srState=0 → ~0x00=0xFF → all outputs HIGH = inactive (matches pull-ups)
         digitalWrite(SR595_OE_PIN, LOW);
     }
 
+    // Full blocking input pass (scan + encoder + SR commit). Used once from setup(), before
+    // the input plane owns the ADC; at runtime the stages run from the scheduler (scan) and
+    // the input-plane tick (encoder, SR commit).
     void readAll(void (*onButtonChange)(int, byte))
+    {
+        unsigned long now = millis();
+        uint16_t adc[LADDER_CHANNELS];
+        for (uint8_t ch = 0; ch < LADDER_CHANNELS; ch++)
+            adc[ch] = analogRead(ROTARY_A0_PIN + ch);
+        scanRotaries(adc);
+        serviceEncoder(now, onButtonChange);
+        commitSr();
+    }
+
+    // Ladder scan task: decode all four ladders from the latest A0-A3 conversions.
+    // The scheduler period is the scan rate.
+    void scanRotaries(const uint16_t adc[LADDER_CHANNELS])
     {
         // ROT1: mode selector — position only, encoder events drive SR bits
-        int rotaryPosition = readRotaryPosition();
+        lastRotaryPosition = decodeAnalogPosition(0, adc[0], lastRotaryPosition);
 
         // ROT2/3/4: simple rotaries — one-hot SR output on position change
-        readRotary2Position();
-        readRotary3Position();
-        readRotary4Position();
+        readSimpleRotary(1, adc[1], ROT2_SR_BASE, lastRotary2Position);
+        readSimpleRotary(2, adc[2], ROT3_SR_BASE, lastRotary3Position);
+        readSimpleRotary(3, adc[3], ROT4_SR_BASE, lastRotary4Position);
+    }
 
+    // Encoder drain (input-plane tick): expire the CCW/CW pulse, then route encoder and
+    // SW to SimHub (serial) or Pro Micro (SR) based on the ROT1 position.
+    void serviceEncoder(unsigned long now, void (*onButtonChange)(int, byte))
+    {
         // Expire active CCW/CW pulse if ENCODER_SR_PULSE_MS has elapsed
-        updateSrPulse();
+        updateSrPulse(now);
+
+        if (lastRotaryPosition <= 0)
+            return;
 
-        // Route encoder and SW to SimHub (serial) or Pro Micro (SR) based on ROT1 position
         bool clkState = digitalRead(ENCODER_CLK_PIN);
         bool dtState  = digitalRead(ENCODER_DT_PIN);
         bool swState  = !digitalRead(ENCODER_SW_PIN); // inverted — INPUT_PULLUP
-        routeEncoderBasedOnRotary(rotaryPosition, swState, clkState, dtState, onButtonChange);
+        routeEncoderBasedOnRotary(lastRotaryPosition, swState, clkState, dtState, now, onButtonChange);
+    }
+
+    // SR commit (input-plane tick, after the encoder): shift the chain once if any bit
+    // changed since the last commit, however many bits changed in between.
+    void commitSr()
+    {
+        if (!_srDirty)
+            return;
+        _srDirty = false;
+        writeAllTo595();
     }
 
     int getRotaryPosition()  { return lastRotaryPosition;  }
@@ -195,222 +291,158 @@ public:
     int getRotary3Position() { return lastRotary3Position; }
     int getRotary4Position() { return lastRotary4Position; }
 
-private:
-    // Decode ADC reading on any rotary pin to position 1-12.
-    int decodeAnalogPosition(uint8_t pin)
-    {
-        int adcValue = analogRead(pin);
-        for (int pos = 0; pos < 12; pos++)
-        {
-            if (adcValue <= ROTARY_THRESHOLDS[pos])
-                return pos + 1;
-        }
-        return 12; // fallback if ADC reads above highest threshold
-    }
+    SHRotaryLadder& getLadder() { return _ladder; }
 
-    // ROT1 — 12-position mode selector (A0).
-    // Position is tracked here; the SR bits for ROT1 are driven by encoder events, not by position change.
-    int readRotaryPosition()
+    // Fill the rotary, SW and SR fields of an input snapshot.
+    void capture(InputSnapshot& snap)
     {
-        if (lastRotaryPosition > 0 && millis() - lastRotaryRead < ROTARY_READ_INTERVAL)
-            return lastRotaryPosition;
-        lastRotaryRead    = millis();
-        lastRotaryPosition = decodeAnalogPosition(ROTARY_A0_PIN);
-        return lastRotaryPosition;
+        snap.rot12 = packPositions(lastRotaryPosition, lastRotary2Position);
+        snap.rot34 = packPositions(lastRotary3Position, lastRotary4Position);
     }
 
-    // ROT2 — simple 12-position rotary (A1). One-hot SR output on change.
-    void readRotary2Position()
+private:
+    static uint8_t packPositions(int low, int high)
     {
-        if (lastRotary2Position > 0 && millis() - lastRotary2Read < ROTARY_READ_INTERVAL)
-            return;
-        lastRotary2Read = millis();
-        int newPos = decodeAnalogPosition(ROTARY_A1_PIN);
-        if (newPos != lastRotary2Position)
-        {
-            if (lastRotary2Position > 0)
-                setSrBit(ROT2_SR_BASE + lastRotary2Position - 1, false);
-            lastRotary2Position = newPos;
-            setSrBit(ROT2_SR_BASE + lastRotary2Position - 1, true);
-            writeAllTo595();
-        }
+        return (uint8_t)((low > 0 ? low : 0) | ((high > 0 ? high : 0) << 4));
     }
 
-    // ROT3 — simple 12-position rotary (A2). One-hot SR output on change.
-    void readRotary3Position()
+    // Decode an ADC reading of rotary channel 0-3 (A0-A3) to position 1-12.
+    // currentPos (≤0 = unknown) selects the hysteresis band and gates ladder learning.
+    int decodeAnalogPosition(uint8_t channel, uint16_t adcValue, int currentPos)
     {
-        if (lastRotary3Position > 0 && millis() - lastRotary3Read < ROTARY_READ_INTERVAL)
-            return;
-        lastRotary3Read = millis();
-        int newPos = decodeAnalogPosition(ROTARY_A2_PIN);
-        if (newPos != lastRotary3Position)
-        {
-            if (lastRotary3Position > 0)
-                setSrBit(ROT3_SR_BASE + lastRotary3Position - 1, false);
-            lastRotary3Position = newPos;
-            setSrBit(ROT3_SR_BASE + lastRotary3Position - 1, true);
-            writeAllTo595();
-        }
+        return _ladder.decode(channel, adcValue, currentPos > 0 ? (uint8_t)currentPos : 0);
     }
 
-    // ROT4 — simple 12-position rotary (A3). One-hot SR output on change.
-    void readRotary4Position()
+    // ROT2/3/4 — simple 12-position rotaries (A1-A3). One-hot SR output on change.
+    void readSimpleRotary(uint8_t channel, uint16_t adcValue, uint8_t srBase, int& lastPos)
     {
-        if (lastRotary4Position > 0 && millis() - lastRotary4Read < ROTARY_READ_INTERVAL)
+        int newPos = decodeAnalogPosition(channel, adcValue, lastPos);
+        if (newPos == lastPos)
             return;
-        lastRotary4Read = millis();
-        int newPos = decodeAnalogPosition(ROTARY_A3_PIN);
-        if (newPos != lastRotary4Position)
-        {
-            if (lastRotary4Position > 0)
-                setSrBit(ROT4_SR_BASE + lastRotary4Position - 1, false);
-            lastRotary4Position = newPos;
-            setSrBit(ROT4_SR_BASE + lastRotary4Position - 1, true);
-            writeAllTo595();
-        }
+        if (lastPos > 0)
+            setSrBit(srBase + lastPos - 1, false);
+        lastPos = newPos;
+        setSrBit(srBase + lastPos - 1, true);
     }
 
     // Route encoder and SW outputs based on current ROT1 position.
-    // SimHub positions → callback (button IDs ≥ 100) → forwarded to SimHub via serial.
-    // 32U4 positions   → SR bits directly (button IDs 0-35 = SR bit indices for SW/CCW/CW).
-    void routeEncoderBasedOnRotary(int rotaryPos, bool sw, bool clk, bool dt, void (*onButtonChange)(int, byte))
+    // The position's routing byte decides the sinks: SR bits (IDs 0-35 = SR bit indices for
+    // SW/CCW/CW), SimHub callback (button IDs ≥ 100, forwarded via serial), both, or neither.
+    void routeEncoderBasedOnRotary(int rotaryPos, bool sw, bool clk, bool dt, unsigned long now, void (*onButtonChange)(int, byte))
     {
-        // Compute base ID: default (pos-1)*3 is the SR bit base for SW/CCW/CW of that position.
-        // Overwritten to ≥100 for SimHub-dedicated positions.
-        int baseButtonId = (rotaryPos - 1) * 3;
-        for (uint8_t i = 0; i < 3; i++)
-        {
-            if (rotaryPos == _simhubPositions[i])
-            {
-                baseButtonId = 100 + i * 3; // slot 0→100-102, slot 1→103-105, slot 2→106-108
-                break;
-            }
-        }
-        bool isSimHub = (baseButtonId >= 100);
+        uint8_t route  = _routeTable[rotaryPos - 1];
+        uint8_t srBase = (uint8_t)((rotaryPos - 1) * 3);
 
         // --- SW button debounce ---
         if (sw != lastSWRawState)
         {
             lastSWRawState   = sw;
-            lastSWChangeTime = millis();
+            lastSWChangeTime = now;
         }
 
-        if ((millis() - lastSWChangeTime) >= SW_DEBOUNCE_DELAY && lastSWReportedState != lastSWRawState)
+        if ((now - lastSWChangeTime) >= SW_DEBOUNCE_DELAY && lastSWReportedState != lastSWRawState)
         {
-            if (isSimHub)
-            {
-                onButtonChange(baseButtonId, lastSWRawState ? 1 : 0);
-            }
-            else
-            {
-                // baseButtonId == (pos-1)*3 == SR bit for SW of this position
-                setSrBit((uint8_t)baseButtonId, lastSWRawState);
-                writeAllTo595();
-            }
+            emitButton(route, srBase, 0, lastSWRawState, onButtonChange);
             lastSWReportedState = lastSWRawState;
-            lastSWButtonId      = baseButtonId;
+            lastSWRoute         = route;
+            lastSWSrBase        = srBase;
         }
 
-        // --- SW held while ROT1 selector moves: migrate hold to new button/bit ---
-        if (lastSWReportedState && lastSWButtonId != -1 && lastSWButtonId != baseButtonId)
+        // --- SW held while ROT1 selector moves (or its route is rewritten): migrate hold ---
+        if (lastSWReportedState && lastSWSrBase != 0xFF && (lastSWSrBase != srBase || lastSWRoute != route))
         {
-            // Release old
-            if (lastSWButtonId >= 100)
-                onButtonChange(lastSWButtonId, 0);
-            else
-                setSrBit((uint8_t)lastSWButtonId, false);
-
-            // Press new
-            if (isSimHub)
-                onButtonChange(baseButtonId, 1);
-            else
-                setSrBit((uint8_t)baseButtonId, true);
-
-            writeAllTo595();
-            lastSWButtonId = baseButtonId;
+            emitButton(lastSWRoute, lastSWSrBase, 0, false, onButtonChange);
+            emitButton(route, srBase, 0, true, onButtonChange);
+            lastSWRoute  = route;
+            lastSWSrBase = srBase;
         }
 
         // --- Rotary encoder (CLK and DT from GPIO) ---
-        // CCW = baseButtonId+1, CW = baseButtonId+2 (also the SR bit indices for 32U4 routing)
-        processRotaryEncoderWithRouting(clk, dt, baseButtonId + 1, baseButtonId + 2, isSimHub, onButtonChange);
+        processRotaryEncoderWithRouting(clk, dt, route, srBase, now, onButtonChange);
+    }
+
+    // Assert/release one of the three outputs (0=SW, 1=CCW, 2=CW) of a position on every
+    // sink its route selects.
+    void emitButton(uint8_t route, uint8_t srBase, uint8_t offset, bool state, void (*onButtonChange)(int, byte))
+    {
+        if (route & ROUTE_SINK_SR)
+            setSrBit(srBase + offset, state);
+        if (route & ROUTE_SINK_SIMHUB)
+            onButtonChange(ROUTE_SIMHUB_BUTTON_BASE + ((route & ROUTE_SLOT_MASK) >> ROUTE_SLOT_SHIFT) * 3 + offset, state ? 1 : 0);
     }
 
-    // State machine for the rotary encoder. Routes CCW/CW to SimHub callback or SR pulse.
-    void processRotaryEncoderWithRouting(bool clk, bool dt, int ccwButtonId, int cwButtonId, bool isSimHub, void (*onButtonChange)(int, byte))
+    // State machine for the rotary encoder. Routes CCW/CW to SimHub callback and/or SR pulse.
+    void processRotaryEncoderWithRouting(bool clk, bool dt, uint8_t route, uint8_t srBase, unsigned long now, void (*onButtonChange)(int, byte))
     {
         uint8_t encoderInput = (dt << 1) | clk;
         uint8_t tableResult  = expandedInputsHalfStepsTable[encoderLastState & 0xf][encoderInput];
         encoderLastState     = tableResult;
 
         uint8_t direction = tableResult & 0x30;
-        if (direction != 0)
+        if (direction == 0)
+            return;
+
+        if (now - lastEncoderEventTime < ENCODER_DEBOUNCE_DELAY)
+            return;
+        lastEncoderEventTime = now;
+
+        uint8_t mode = route & ROUTE_MODE_MASK;
+        if (mode == ROUTE_MODE_SW_ONLY)
+            return;
+
+        // offset 1 = CCW, 2 = CW (also the SR bit offsets from srBase)
+        uint8_t offset = (direction == DIR_CCW) ? 1 : 2;
+        if (mode == ROUTE_MODE_REVERSED)
+            offset ^= 3;
+        encoderCounter += (offset == 2) ? 1 : -1;
+
+        if (route & ROUTE_SINK_SR)
+            triggerSrPulse(srBase + offset, now);
+        if (route & ROUTE_SINK_SIMHUB)
         {
-            unsigned long now = millis();
-            if (now - lastEncoderEventTime >= ENCODER_DEBOUNCE_DELAY)
-            {
-                if (direction == DIR_CCW)
-                {
-                    encoderCounter--;
-                    if (isSimHub)
-                    {
-                        onButtonChange(ccwButtonId, 1);
-                        onButtonChange(ccwButtonId, 0);
-                    }
-                    else
-                    {
-                        triggerSrPulse((uint8_t)ccwButtonId); // ccwButtonId IS the SR CCW bit
-                    }
-                }
-                else if (direction == DIR_CW)
-                {
-                    encoderCounter++;
-                    if (isSimHub)
-                    {
-                        onButtonChange(cwButtonId, 1);
-                        onButtonChange(cwButtonId, 0);
-                    }
-                    else
-                    {
-                        triggerSrPulse((uint8_t)cwButtonId); // cwButtonId IS the SR CW bit
-                    }
-                }
-                lastEncoderEventTime = now;
-            }
+            int buttonId = ROUTE_SIMHUB_BUTTON_BASE + ((route & ROUTE_SLOT_MASK) >> ROUTE_SLOT_SHIFT) * 3 + offset;
+            onButtonChange(buttonId, 1);
+            onButtonChange(buttonId, 0);
         }
     }
 
-    // Set or clear a single bit in the SR state buffer.
+    // Set or clear a single bit in the SR state buffer. The chain is shifted by commitSr().
+    // Atomic: ROT2-4 bits are set from the main loop, encoder bits from the input-plane tick.
     void setSrBit(uint8_t bitIndex, bool value)
     {
         uint8_t byteIdx = bitIndex / 8;
         uint8_t bitPos  = bitIndex % 8;
         if (byteIdx >= SR_CHIP_COUNT) return;
-        if (value)
-            _srState[byteIdx] |=  (uint8_t)(1 << bitPos);
-        else
-            _srState[byteIdx] &= ~(uint8_t)(1 << bitPos);
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        {
+            uint8_t old = _srState[byteIdx];
+            if (value)
+                _srState[byteIdx] |=  (uint8_t)(1 << bitPos);
+            else
+                _srState[byteIdx] &= ~(uint8_t)(1 << bitPos);
+            if (_srState[byteIdx] != old)
+                _srDirty = true;
+        }
     }
 
     // Begin a 30 ms SR pulse on bitIndex for a CCW/CW encoder event.
     // Cancels any still-active pulse from a previous event.
-    void triggerSrPulse(uint8_t bitIndex)
+    void triggerSrPulse(uint8_t bitIndex, unsigned long now)
     {
         if (_activePulseBit >= 0)
             setSrBit((uint8_t)_activePulseBit, false); // cancel old pulse immediately
         _activePulseBit = (int8_t)bitIndex;
-        _pulseStartTime = millis();
+        _pulseStartTime = now;
         setSrBit(bitIndex, true);
-        writeAllTo595();
     }
 
-    // Called every readAll() cycle: expire active CCW/CW pulse when time has elapsed.
-    void updateSrPulse()
+    // Called every serviceEncoder() pass: expire active CCW/CW pulse when time has elapsed.
+    void updateSrPulse(unsigned long now)
     {
-        if (_activePulseBit >= 0 && (millis() - _pulseStartTime) >= ENCODER_SR_PULSE_MS)
+        if (_activePulseBit >= 0 && (now - _pulseStartTime) >= ENCODER_SR_PULSE_MS)
         {
             setSrBit((uint8_t)_activePulseBit, false);
             _activePulseBit = -1;
-            writeAllTo595();
         }
     }
 
@@ -423,12 +455,26 @@ private:
     // shifting so the 74HC595 pulls a line LOW to assert "pressed".
     // Idle state: _srState=0x00 → ~0x00=0xFF → all outputs HIGH → matches pull-ups → clean boot.
     // MMJoy2 button assignments must be configured as active-LOW (inverted) to match.
+    //
+    // Bit-banged on the port registers (same MSBFIRST order as shiftOut): ~50 µs for the
+    // 72 bits instead of ~1 ms through digitalWrite(), which matters inside the 1 kHz tick.
     void writeAllTo595()
     {
-        digitalWrite(SR595_LATCH_PIN, LOW);
+        *_srLatchPort &= ~_srLatchMask;
         for (int8_t i = SR_CHIP_COUNT - 1; i >= 0; i--)
-            shiftOut(SR595_DATA_PIN, SR595_CLOCK_PIN, MSBFIRST, ~_srState[i]);
-        digitalWrite(SR595_LATCH_PIN, HIGH);
-        digitalWrite(SR595_LATCH_PIN, LOW);
+        {
+            uint8_t out = ~_srState[i];
+            for (uint8_t mask = 0x80; mask; mask >>= 1)
+            {
+                if (out & mask)
+                    *_srDataPort |= _srDataMask;
+                else
+                    *_srDataPort &= ~_srDataMask;
+                *_srClockPort |= _srClockMask;
+                *_srClockPort &= ~_srClockMask;
+            }
+        }
+        *_srLatchPort |= _srLatchMask;
+        *_srLatchPort &= ~_srLatchMask;
     }
 };
@@ -2,6 +2,7 @@
 #define FlowSerialFlush Serial.flush
 
 #include "ArqSerial.h"
+#include "SHMessage.h"
 ARQSerial arqserial;
 
 #define FlowSerialAvailable() arqserial.Available()
@@ -11,6 +12,7 @@ ARQSerial arqserial;
 String FlowSerialReadStringUntil(char terminator) { return arqserial.ReadStringUntil(terminator); }
 String FlowSerialReadStringUntil(char terminator1, char terminator2) { return arqserial.ReadStringUntil(terminator1, terminator2); }
 void FlowSerialReadStringUntil(char buffer[], char terminator){ arqserial.ReadStringUntil(buffer, terminator); }
+uint8_t FlowSerialReadStringUntil(char buffer[], uint8_t size, char terminator1, char terminator2) { return arqserial.ReadStringUntil(buffer, size, terminator1, terminator2); }
 
 void FlowSerialPrint(String& data) { arqserial.WriteString(data); }
 void FlowSerialPrint(char data){	arqserial.Print(data);}
@@ -20,6 +22,9 @@ void FlowSerialDebugPrintLn(const char str[]) {	arqserial.DebugPrintLn(str);}
 void FlowSerialPrintLn(String& data){	arqserial.PrintLn(data);}
 void FlowSerialPrintLn(const char str[]) {	arqserial.PrintLn(str);}
 void FlowSerialPrintLn() { arqserial.PrintLn();}
+template <uint8_t N> void FlowSerialPrintLn(const SHMessageBuffer<N>& msg) { arqserial.PrintLn(msg.data(), msg.length()); }
+template <uint8_t N> void FlowSerialDebugPrintLn(const SHMessageBuffer<N>& msg) { arqserial.DebugPrintLn(msg.data(), msg.length()); }
+void FlowSerialPrintLn(const __FlashStringHelper* str) { SHMessage m; m.key(str); FlowSerialPrintLn(m); }
 
 void SetBaudrate() {
 	int br = FlowSerialTimedRead();
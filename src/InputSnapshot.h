@@ -0,0 +1,58 @@
+#pragma once
+#include <Arduino.h>
+
+// One packed copy of the inputs the custom protocol reports (ROT1-4), captured once per
+// input scan. The other inputs already reach the host on their own paths — SW and SR through
+// the 74HC595 chain to the Pro Micro, buttons as SimHub button events, clutch as PWM and
+// CLT: — so they are not copied here.
+//
+// InputSnapshotBuffer double-buffers it: the scan fills current(), diff() XORs it against
+// the last acknowledged snapshot and returns a SNAP_* mask of the fields that changed, and
+// acknowledge() flips the buffers once those changes have been sent. All changes of one
+// scan go out together.
+
+// Field-change mask bits returned by diff()
+#define SNAP_ROT1    0x01
+#define SNAP_ROT2    0x02
+#define SNAP_ROT3    0x04
+#define SNAP_ROT4    0x08
+
+struct InputSnapshot
+{
+    uint8_t  rot12;              // ROT1 position (low nibble) / ROT2 (high nibble), 1-12, 0 = not read yet
+    uint8_t  rot34;              // ROT3 (low nibble) / ROT4 (high nibble)
+
+    uint8_t rot1() const { return rot12 & 0x0F; }
+    uint8_t rot2() const { return rot12 >> 4; }
+    uint8_t rot3() const { return rot34 & 0x0F; }
+    uint8_t rot4() const { return rot34 >> 4; }
+};
+
+class InputSnapshotBuffer
+{
+private:
+    InputSnapshot _buf[2] = {};
+    uint8_t _cur = 0; // snapshot being filled; _cur ^ 1 is the last acknowledged one
+
+public:
+    InputSnapshot& current() { return _buf[_cur]; }
+    const InputSnapshot& acknowledged() const { return _buf[_cur ^ 1]; }
+
+    uint8_t diff() const
+    {
+        const InputSnapshot& a = _buf[_cur];
+        const InputSnapshot& b = _buf[_cur ^ 1];
+        uint8_t mask = 0;
+
+        uint8_t x = a.rot12 ^ b.rot12;
+        if (x & 0x0F) mask |= SNAP_ROT1;
+        if (x & 0xF0) mask |= SNAP_ROT2;
+        x = a.rot34 ^ b.rot34;
+        if (x & 0x0F) mask |= SNAP_ROT3;
+        if (x & 0xF0) mask |= SNAP_ROT4;
+        return mask;
+    }
+
+    // The current snapshot becomes the acknowledged one; the next scan overwrites the other.
+    void acknowledge() { _cur ^= 1; }
+};
@@ -75,6 +75,11 @@ public:
   bool pop() __attribute__((noinline));
   /* Pop the data at the beginning of the buffer with interrupt disabled */
   bool lockedPop(rg_element_t &outElement);
+  /* Point at the elements at the beginning of the buffer without popping them. Returns how
+     many are contiguous (up to the wrap point), not interrupt safe */
+  uint8_t peekSpan(const rg_element_t* &outSpan);
+  /* Drop count elements from the beginning of the buffer, typically after peekSpan */
+  void consume(uint8_t count);
   /* Return true if the buffer is full */
   bool isFull()  { return mSize == __maxSize__; }
   /* Return true if the buffer is empty */
@@ -179,6 +184,24 @@ bool RingBuffer<rg_element_t, __maxSize__>::lockedPop(rg_element_t &outElement)
   return result;
 }
 
+template <typename rg_element_t, uint8_t __maxSize__>
+uint8_t RingBuffer<rg_element_t, __maxSize__>::peekSpan(const rg_element_t* &outSpan)
+{
+  outSpan = mBuffer + mReadIndex;
+  uint8_t toEnd = __maxSize__ - mReadIndex;
+  return mSize < toEnd ? mSize : toEnd;
+}
+
+template <typename rg_element_t, uint8_t __maxSize__>
+void RingBuffer<rg_element_t, __maxSize__>::consume(uint8_t count)
+{
+  if (count > mSize) count = mSize;
+  uint16_t index = (uint16_t)mReadIndex + (uint16_t)count;
+  if (index >= (uint16_t)__maxSize__) index -= (uint16_t)__maxSize__;
+  mReadIndex = (uint8_t)index;
+  mSize -= count;
+}
+
 template <typename rg_element_t, uint8_t __maxSize__>
 rg_element_t &RingBuffer<rg_element_t, __maxSize__>::operator[](uint8_t inIndex)
 {
@@ -0,0 +1,44 @@
+#pragma once
+#include <Arduino.h>
+
+// Fixed-point dual clutch combination.
+//
+// PWM = A × (100 - BP)/100 + B × BP/100, with the bite point held as tenths of a percent
+// (0-1000) and converted once, when it changes, to a Q16 weight for clutch B. Combining a
+// sample is then two 16×32 multiplies and a shift — no division, no float — which is what
+// runs on every clutch sample in the input-plane tick.
+//
+// Result is truncated like the original double formula and stays within 1 LSB of it
+// (checked over the full input grid by X clutchbench).
+
+#define CLUTCH_BP_MAX  1000   // bite point full scale, tenths of a percent
+#define CLUTCH_Q16_ONE 65536UL
+
+// Q16 weight of clutch B for a bite point in tenths of a percent (0-1000), rounded.
+static inline uint32_t clutchBiteWeightQ16(uint16_t bpTenths)
+{
+  return ((uint32_t)bpTenths * CLUTCH_Q16_ONE + CLUTCH_BP_MAX / 2) / CLUTCH_BP_MAX;
+}
+
+// Combine calibrated clutch values (any width up to 16 bits) with a Q16 clutch-B weight.
+// Never exceeds max(a, b).
+static inline uint16_t clutchCombineQ16(uint16_t a, uint16_t b, uint32_t weightB)
+{
+  uint32_t acc = (uint32_t)a * (CLUTCH_Q16_ONE - weightB) + (uint32_t)b * weightB;
+  return (uint16_t)(acc >> 16);
+}
+
+// The original floating-point formula, kept only as the X clutchbench reference.
+// full is the input/output full scale: 1023 as originally written, CLUTCH_AXIS_MAX for
+// the oversampled axis.
+static uint16_t clutchCombineReference(uint16_t a, uint16_t b, uint16_t bpTenths, uint16_t full)
+{
+  double bitePoint = bpTenths / 10.0;
+  double clutchAPercent = (a / (double)full) * 100.0;
+  double clutchBPercent = (b / (double)full) * 100.0;
+  double weightA = (100.0 - bitePoint) / 100.0;
+  double weightB = bitePoint / 100.0;
+  double combinedPercent = (clutchAPercent * weightA) + (clutchBPercent * weightB);
+  uint16_t pwmValue = (uint16_t)((combinedPercent / 100.0) * full);
+  return constrain(pwmValue, 0, full);
+}
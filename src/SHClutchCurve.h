@@ -0,0 +1,140 @@
+#pragma once
+#include <Arduino.h>
+#include <util/atomic.h>
+#include "SHEepromStore.h"
+
+// Clutch response curve: piecewise-linear LUT over the calibrated axis.
+//
+// 2^CLUTCH_CURVE_SEGMENT_BITS equal segments (17 knots by default, 33 with 5). Knot i is
+// the output at input i << CLUTCH_CURVE_FRAC_BITS, so evaluating is one shift for the
+// segment, one mask for the position inside it and an 8-bit-fraction lerp — no division.
+// The last knot sits one count past CLUTCH_AXIS_MAX (4096 at 12 bits), which keeps every
+// segment the same width and lets full travel reach full scale; evaluate() clamps the
+// result to CLUTCH_AXIS_MAX.
+//
+// The host sends knots in permille of full travel (CRV:k0,k1,…,kN, see SHCustomProtocol.h);
+// they are converted to axis units once, and persisted (permille, CRC-protected,
+// EEPROM_ADDR_CLUTCH_CURVE) so the curve survives a reboot without SimHub. The save is
+// deferred to service() (scheduler task) once the curve has been stable for
+// CLUTCH_CURVE_SAVE_DELAY_MS: a record is ~35 EEPROM cells at 3.3 ms each, far too long
+// to spend inside SHCustomProtocol::read() before the 'P' ack, and a host slider being
+// dragged would otherwise write every step. service() also runs from inside ARQ's serial
+// reads, so it only writes while the link is quiet and a few cells per call
+// (SHEepromStore::saveStep). Until the pass completes the curve is live but not persisted.
+// Needs CLUTCH_AXIS_BITS / CLUTCH_AXIS_MAX — included from SHDualClutchSensor.h.
+
+#define CLUTCH_CURVE_SEGMENT_BITS    4
+#define CLUTCH_CURVE_KNOTS           ((1 << CLUTCH_CURVE_SEGMENT_BITS) + 1)
+#define CLUTCH_CURVE_FRAC_BITS       (CLUTCH_AXIS_BITS - CLUTCH_CURVE_SEGMENT_BITS)
+#define CLUTCH_CURVE_PERMILLE        1000
+#define CLUTCH_CURVE_RECORD_VERSION  1
+#define CLUTCH_CURVE_SAVE_DELAY_MS   2000
+
+#if CLUTCH_CURVE_SEGMENT_BITS < 4 || CLUTCH_CURVE_SEGMENT_BITS > 5
+#error "CLUTCH_CURVE_SEGMENT_BITS must be 4 (17 knots) or 5 (33 knots)"
+#endif
+#if CLUTCH_CURVE_FRAC_BITS > 8
+#error "Curve lerp uses an 8-bit fraction: raise CLUTCH_CURVE_SEGMENT_BITS"
+#endif
+
+class SHClutchCurve
+{
+private:
+  uint16_t _knot[CLUTCH_CURVE_KNOTS]; // axis units, 0 to CLUTCH_AXIS_MAX + 1
+  bool _stored = false;
+  bool _dirty = false;                // set() applied a curve that is not saved yet
+  uint8_t _savePos = 0;               // saveStep() cursor into the record
+  unsigned long _changedAt = 0;
+
+  // 1000 permille maps to CLUTCH_AXIS_MAX + 1, one past the last axis value.
+  static uint16_t toAxis(uint16_t permille)
+  {
+    return (uint16_t)(((uint32_t)permille * (CLUTCH_AXIS_MAX + 1UL) + CLUTCH_CURVE_PERMILLE / 2) / CLUTCH_CURVE_PERMILLE);
+  }
+
+  void loadLinear()
+  {
+    for (uint8_t i = 0; i < CLUTCH_CURVE_KNOTS; i++)
+      _knot[i] = (uint16_t)i << CLUTCH_CURVE_FRAC_BITS;
+  }
+
+public:
+  // Restore the persisted curve, or fall back to linear.
+  void begin()
+  {
+    uint16_t permille[CLUTCH_CURVE_KNOTS];
+    _stored = SHEepromStore::load(EEPROM_ADDR_CLUTCH_CURVE, CLUTCH_CURVE_RECORD_VERSION, permille, sizeof(permille));
+    for (uint8_t i = 0; _stored && i < CLUTCH_CURVE_KNOTS; i++)
+      _stored = permille[i] <= CLUTCH_CURVE_PERMILLE;
+    if (_stored)
+    {
+      for (uint8_t i = 0; i < CLUTCH_CURVE_KNOTS; i++)
+        _knot[i] = toAxis(permille[i]);
+    }
+    else
+      loadLinear();
+  }
+
+  // Shape one calibrated axis value (0-CLUTCH_AXIS_MAX). Runs in the input-plane tick.
+  uint16_t evaluate(uint16_t x) const
+  {
+    uint8_t seg = x >> CLUTCH_CURVE_FRAC_BITS;
+    uint8_t frac = x & ((1 << CLUTCH_CURVE_FRAC_BITS) - 1);
+    int16_t rise = (int16_t)_knot[seg + 1] - (int16_t)_knot[seg];
+    uint16_t y = _knot[seg] + (int16_t)(((int32_t)rise * frac) >> CLUTCH_CURVE_FRAC_BITS);
+    return y > CLUTCH_AXIS_MAX ? CLUTCH_AXIS_MAX : y;
+  }
+
+  // Replace the curve from host knots (permille, CLUTCH_CURVE_KNOTS of them); service()
+  // persists it later.
+  // Returns false when a knot is out of range or nothing changed — the host repeats the
+  // token every cycle, so only an actual change costs the copy and the EEPROM compare.
+  bool set(const uint16_t permille[CLUTCH_CURVE_KNOTS])
+  {
+    uint16_t knot[CLUTCH_CURVE_KNOTS];
+    bool changed = false;
+    for (uint8_t i = 0; i < CLUTCH_CURVE_KNOTS; i++)
+    {
+      if (permille[i] > CLUTCH_CURVE_PERMILLE)
+        return false;
+      knot[i] = toAxis(permille[i]);
+      changed |= knot[i] != _knot[i];
+    }
+    if (!changed)
+      return false;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) // read by evaluate() in the input-plane tick
+    {
+      memcpy(_knot, knot, sizeof(_knot));
+    }
+    _dirty = true;
+    _savePos = 0; // a half-written pass restarts with the new knots
+    _changedAt = millis();
+    return true;
+  }
+
+  // Scheduler side: write a changed curve once it has been stable for
+  // CLUTCH_CURVE_SAVE_DELAY_MS, one bounded step per call while the link is quiet
+  // (lastRx from ArqSerial::lastRx()).
+  void service(unsigned long now, unsigned long lastRx)
+  {
+    if (!_dirty || now - _changedAt < CLUTCH_CURVE_SAVE_DELAY_MS || !SHEepromStore::linkQuiet(now, lastRx))
+      return;
+    uint16_t record[CLUTCH_CURVE_KNOTS];
+    for (uint8_t i = 0; i < CLUTCH_CURVE_KNOTS; i++)
+      record[i] = permille(i);
+    if (SHEepromStore::saveStep(EEPROM_ADDR_CLUTCH_CURVE, CLUTCH_CURVE_RECORD_VERSION, record, sizeof(record), _savePos))
+    {
+      _dirty = false;
+      _stored = true;
+    }
+  }
+
+  // Knot i in permille (exact round trip: axis resolution is finer than 0.1 %).
+  uint16_t permille(uint8_t i) const
+  {
+    return (uint16_t)(((uint32_t)_knot[i] * CLUTCH_CURVE_PERMILLE + (CLUTCH_AXIS_MAX + 1UL) / 2) / (CLUTCH_AXIS_MAX + 1UL));
+  }
+
+  bool isStored() const { return _stored; }
+};
@@ -0,0 +1,187 @@
+#pragma once
+#include <Arduino.h>
+
+// Per-channel clutch filter stage, all O(1) per sample and integer-only.
+//
+//   CLUTCH_FILTER_NONE  pass-through.
+//   CLUTCH_FILTER_SMA   running-sum moving average, window 2^p1 (1-16). Group delay (N-1)/2 samples.
+//   CLUTCH_FILTER_IIR   first-order y += (x - y) >> p1 (p1 = 0-8). Group delay 2^p1 - 1 samples.
+//   CLUTCH_FILTER_EURO  One-Euro adaptive low-pass: cutoff = p1 × 0.1 Hz at rest, raised by
+//                       p2 × 0.1 Hz per axis count/sample of (1 Hz-filtered) speed. Smooth when the
+//                       lever is still, near-zero lag while it moves. One 32-bit divide per sample.
+//
+// State is kept in Q8 so IIR/One-Euro don't lose the fractional part of small steps.
+//
+// Each filter also measures itself over CLUTCH_FILTER_WINDOW samples:
+//   noise  — peak-to-peak of input and output (meaningful with the lever at rest);
+//   lag    — Σ|x − y| / Σ|Δx|, the tracking delay in samples while the lever moves
+//            (only reported when the input spanned at least CLUTCH_FILTER_MIN_TRAVEL counts).
+
+#define CLUTCH_FILTER_NONE 0
+#define CLUTCH_FILTER_SMA  1
+#define CLUTCH_FILTER_IIR  2
+#define CLUTCH_FILTER_EURO 3
+
+#define CLUTCH_FILTER_SMA_MAX_SHIFT 4   // 16-sample window
+#define CLUTCH_FILTER_IIR_MAX_SHIFT 8
+#define CLUTCH_FILTER_WINDOW        256 // samples per measurement window
+#define CLUTCH_FILTER_MIN_TRAVEL    512 // axis counts of input span before lag is reported
+
+// Compile-time default for both channels (X clutchfilter changes it at runtime)
+#define CLUTCH_FILTER_DEFAULT    CLUTCH_FILTER_SMA
+#define CLUTCH_FILTER_DEFAULT_P1 2      // SMA window 4, as before
+#define CLUTCH_FILTER_DEFAULT_P2 0
+
+// One-Euro derivative cutoff is fixed at 1 Hz.
+#define CLUTCH_FILTER_EURO_DCUTOFF_X10 10
+
+class SHClutchFilter
+{
+private:
+  uint8_t _type = CLUTCH_FILTER_NONE;
+  uint8_t _p1 = 0;
+  uint8_t _p2 = 0;
+  uint32_t _wPerTenthHz = 0; // Q16 2π·Te per 0.1 Hz of cutoff (set from the sample period)
+
+  // SMA
+  uint16_t _ring[1 << CLUTCH_FILTER_SMA_MAX_SHIFT];
+  uint8_t _ringIndex = 0;
+  uint32_t _sum = 0;
+
+  // IIR / One-Euro (Q8)
+  int32_t _y = 0;
+  int32_t _xPrev = 0;
+  int32_t _dx = 0;
+  uint16_t _alphaD = 0;      // Q16 smoothing of the One-Euro derivative
+
+  // Measurement (current window, last completed window)
+  uint16_t _count = 0;
+  uint16_t _inMin = 0xFFFF, _inMax = 0, _outMin = 0xFFFF, _outMax = 0;
+  uint32_t _errSum = 0, _moveSum = 0;
+  uint16_t _lastRaw = 0;
+  uint16_t _noiseIn = 0, _noiseOut = 0;
+  uint16_t _lagX16 = 0xFFFF;  // samples × 16 from the last window with travel, 0xFFFF = none yet
+
+  // (v × a) >> 16 for a Q16 factor, without a 64-bit multiply.
+  static int32_t mulQ16(int32_t v, uint16_t a)
+  {
+    return (v >> 16) * (int32_t)a + (int32_t)(((uint32_t)(v & 0xFFFF) * a) >> 16);
+  }
+
+  // Q16 smoothing factor for a cutoff in 0.1 Hz: α = 1 − 1/(1 + 2π·fc·Te).
+  uint16_t alphaForCutoff(uint16_t cutoffX10) const
+  {
+    uint32_t w = (uint32_t)cutoffX10 * _wPerTenthHz;
+    uint32_t inv = 0xFFFFFFFFUL / (w + 65536UL);
+    return (uint16_t)(65535U - (inv > 65535U ? 65535U : inv));
+  }
+
+  uint16_t step(uint16_t x)
+  {
+    switch (_type)
+    {
+    case CLUTCH_FILTER_SMA:
+    {
+      uint8_t mask = (1 << _p1) - 1;
+      _sum += x;
+      _sum -= _ring[_ringIndex];
+      _ring[_ringIndex] = x;
+      _ringIndex = (_ringIndex + 1) & mask;
+      return (uint16_t)(_sum >> _p1);
+    }
+    case CLUTCH_FILTER_IIR:
+      _y += (((int32_t)x << 8) - _y) >> _p1;
+      return (uint16_t)((_y + 128) >> 8);
+    case CLUTCH_FILTER_EURO:
+    {
+      int32_t xq = (int32_t)x << 8;
+      int32_t dx = xq - _xPrev;
+      _xPrev = xq;
+      _dx += mulQ16(dx - _dx, _alphaD);
+      uint32_t speed = (uint32_t)(_dx < 0 ? -_dx : _dx);     // Q8 axis counts/sample
+      uint32_t cutoff = _p1 + ((speed * _p2) >> 8);           // 0.1 Hz
+      uint16_t alpha = alphaForCutoff(cutoff > 0xFFFF ? 0xFFFF : (uint16_t)cutoff);
+      _y += mulQ16(xq - _y, alpha);
+      return (uint16_t)((_y + 128) >> 8);
+    }
+    default:
+      return x;
+    }
+  }
+
+public:
+  // Select the filter and reset its state to x (no start-up transient).
+  // samplePeriodUs is the fixed interval between update() calls.
+  // Returns false (and keeps the current filter) when parameters are out of range.
+  bool configure(uint8_t type, uint8_t p1, uint8_t p2, uint16_t x, uint16_t samplePeriodUs)
+  {
+    if (type == CLUTCH_FILTER_SMA && p1 > CLUTCH_FILTER_SMA_MAX_SHIFT) return false;
+    if (type == CLUTCH_FILTER_IIR && p1 > CLUTCH_FILTER_IIR_MAX_SHIFT) return false;
+    if (type == CLUTCH_FILTER_EURO && p1 == 0) return false;
+    if (type > CLUTCH_FILTER_EURO) return false;
+
+    _type = type;
+    _p1 = p1;
+    _p2 = p2;
+    // 2π × Te[s] × 0.1 Hz in Q16 = 6.2832 × Te[µs] × 65536 / 1e7
+    _wPerTenthHz = ((uint32_t)samplePeriodUs * 41177UL + 500000UL) / 1000000UL;
+    _alphaD = alphaForCutoff(CLUTCH_FILTER_EURO_DCUTOFF_X10);
+
+    for (uint8_t i = 0; i < (1 << CLUTCH_FILTER_SMA_MAX_SHIFT); i++)
+      _ring[i] = x;
+    _ringIndex = 0;
+    _sum = (uint32_t)x << p1;
+    _y = (int32_t)x << 8;
+    _xPrev = _y;
+    _dx = 0;
+    _lastRaw = x;
+    _lagX16 = 0xFFFF;
+    return true;
+  }
+
+  uint16_t update(uint16_t x)
+  {
+    uint16_t y = step(x);
+
+    // Measurement window
+    if (x < _inMin) _inMin = x;
+    if (x > _inMax) _inMax = x;
+    if (y < _outMin) _outMin = y;
+    if (y > _outMax) _outMax = y;
+    _errSum += (x > y) ? x - y : y - x;
+    _moveSum += (x > _lastRaw) ? x - _lastRaw : _lastRaw - x;
+    _lastRaw = x;
+    if (++_count >= CLUTCH_FILTER_WINDOW)
+    {
+      _noiseIn = _inMax - _inMin;
+      _noiseOut = _outMax - _outMin;
+      if (_noiseIn >= CLUTCH_FILTER_MIN_TRAVEL && _moveSum)
+        _lagX16 = (uint16_t)min(0xFFFEUL, (_errSum << 4) / _moveSum); // else keep the last moving window
+      _count = 0;
+      _inMin = _outMin = 0xFFFF;
+      _inMax = _outMax = 0;
+      _errSum = _moveSum = 0;
+    }
+    return y;
+  }
+
+  uint8_t type() const { return _type; }
+  uint8_t p1() const { return _p1; }
+  uint8_t p2() const { return _p2; }
+
+  // Theoretical group delay at rest, in samples × 16.
+  uint16_t groupDelayX16() const
+  {
+    switch (_type)
+    {
+    case CLUTCH_FILTER_SMA:  return (uint16_t)(((1 << _p1) - 1) << 3);
+    case CLUTCH_FILTER_IIR:  return (uint16_t)(((1UL << _p1) - 1) << 4);
+    case CLUTCH_FILTER_EURO: return (uint16_t)min(0xFFFEUL, (16UL << 16) / ((uint32_t)_p1 * _wPerTenthHz)); // 1/w at min cutoff
+    default:                 return 0;
+    }
+  }
+
+  uint16_t noiseIn() const { return _noiseIn; }
+  uint16_t noiseOut() const { return _noiseOut; }
+  uint16_t lagX16() const { return _lagX16; }
+};
@@ -1,44 +1,185 @@
 #pragma once
 #include <Arduino.h>
+#include <util/atomic.h>
 
-// 10-bit PWM Clutch Control on Pin 9 (Timer 1)
-// Range: 0-1023 (10-bit resolution)
+// PWM Clutch Control on Pin 9 (Timer 1, Fast PWM with TOP = ICR1)
+// Resolution is CLUTCH_PWM_BITS; the carrier is F_CPU / 2^bits, so each extra bit halves it:
+//   10 bits → 15.6 kHz (previous fixed mode 7), 11 → 7.8 kHz, 12 → 3.9 kHz, 14 → 977 Hz, 16 → 244 Hz.
+// Lower carriers need a slower RC filter on the Pro Micro side to keep ripple below one step.
 // PWM is computed in real-time from dual clutch sensors + bite point — no persistence needed.
+//
+// Hardware variant CLUTCH_DUAL_PWM: OC1A (D9) and OC1B (D10) both run 8-bit PWM at 62.5 kHz
+// and are summed through weighted resistors, OC1A coarse and OC1B fine at 1/256 of its weight
+// (e.g. 1 kΩ and 256 kΩ — 0.1 % parts keep the sum monotonic; trim with a pot in practice).
+// setValue() splits a 16-bit value across the two channels: a 16-bit axis voltage from a
+// carrier four times faster than the single 10-bit output. The 74HC595 data line moves from
+// D10 to D7 (ExpandedInputsPreProcessor.h).
+//
+// Both channels use inverted compare output with OCR = TOP - x. In non-inverted Fast PWM,
+// OCR = 0 still gives a one-clock pulse every period, so duty is (OCR + 1) / 256 and the sum
+// would sit 257/65536 (~0.4 %) above zero with the clutch released. Inverted, the duty is
+// exactly x / 256 and x = 0 (OCR = TOP) is a constant low. The remaining endpoint error is
+// at the top: 65535 gives 65535/65536 of Vcc, one 16-bit step short of full scale. The
+// single 10-bit output keeps its non-inverted 1/1024 floor at zero and reaches Vcc at TOP.
+#define CLUTCH_DUAL_PWM 0
+
+#if CLUTCH_DUAL_PWM
+#define CLUTCH_PWM_BITS         16 // coarse:fine 8:8
+#define CLUTCH_PWM_CHANNEL_BITS 8
+#else
+#define CLUTCH_PWM_BITS         10
+#define CLUTCH_PWM_CHANNEL_BITS CLUTCH_PWM_BITS
+#endif
 #define CLUTCH_PWM_MIN 0
-#define CLUTCH_PWM_MAX 1023
+#define CLUTCH_PWM_MAX ((1UL << CLUTCH_PWM_BITS) - 1)
+#define CLUTCH_PWM_TOP ((1U << CLUTCH_PWM_CHANNEL_BITS) - 1) // ICR1
+
+#if CLUTCH_PWM_BITS < 8 || CLUTCH_PWM_BITS > 16
+#error "CLUTCH_PWM_BITS must be 8-16"
+#endif
+
+// Optional first-order sigma-delta dither (0 = off, no Timer1 interrupt). The clutch axis has
+// more bits than the PWM (12 vs 10 by default); with dither depth d the TIMER1_OVF ISR
+// alternates OCR1A between adjacent codes so the RC-filtered average carries d extra bits.
+// The dither pattern repeats every 2^d PWM periods, so its lowest tone is carrier / 2^d:
+//   d = 1 → 7.8 kHz, 2 → 3.9 kHz, 3 → 1.95 kHz, 4 → 977 Hz (at 10 bits / 15.6 kHz).
+// Pick d so the Pro Micro RC filter corner sits well below that tone; X clutchdither sets
+// the depth at runtime (≤ CLUTCH_DITHER_BITS). Depth beyond the axis's extra bits adds
+// nothing. ISR cost ~1.5 µs per carrier period (~2.5 % CPU at 15.6 kHz).
+#define CLUTCH_DITHER_BITS 0
+
+#if CLUTCH_DITHER_BITS > 6 || CLUTCH_PWM_BITS + CLUTCH_DITHER_BITS > 16
+#error "CLUTCH_DITHER_BITS must be 0-6 and CLUTCH_PWM_BITS + CLUTCH_DITHER_BITS <= 16"
+#endif
+#if CLUTCH_DUAL_PWM && CLUTCH_DITHER_BITS > 0
+#error "CLUTCH_DUAL_PWM already resolves 16 bits — disable CLUTCH_DITHER_BITS"
+#endif
 
 class SHClutchPWM
 {
 private:
   uint16_t clutchValue = 0;
-  const uint8_t CLUTCH_PIN = 9; // Timer 1 Pin A (10-bit PWM)
+  const uint8_t CLUTCH_PIN = 9; // Timer 1 Pin A
+#if CLUTCH_DUAL_PWM
+  const uint8_t CLUTCH_FINE_PIN = 10; // Timer 1 Pin B
+#endif
+#if CLUTCH_DITHER_BITS > 0
+  uint8_t ditherDepth = CLUTCH_DITHER_BITS;
+  uint8_t ditherFrac = 0; // fraction below clutchValue, scaled to 8 bits
+  uint8_t ditherAcc = 0;
+#endif
 
 public:
   void begin()
   {
     pinMode(CLUTCH_PIN, OUTPUT);
+#if CLUTCH_DUAL_PWM
+    pinMode(CLUTCH_FINE_PIN, OUTPUT);
+#endif
 
-    // Configure Timer 1 for 10-bit Fast PWM mode
-    // WGM13:10 = 0111 (mode 7: 10-bit Fast PWM)
-    // COM1A1:0 = 10 (non-inverted PWM on OC1A/pin9)
+    // Configure Timer 1 for Fast PWM with TOP = ICR1
+    // WGM13:10 = 1110 (mode 14: Fast PWM, TOP = ICR1 = CLUTCH_PWM_TOP)
+    // COM1A1:0 = 10 (non-inverted PWM on OC1A/pin9); dual variant: 11 (inverted) on OC1A and OC1B/pin10
     // CS12:10 = 001 (no prescaler, F_CPU clock)
     cli();
     TCCR1A = 0;
     TCCR1B = 0;
-    TCCR1A |= (1 << WGM11) | (1 << WGM10);
-    TCCR1B |= (1 << WGM12);
+    ICR1 = CLUTCH_PWM_TOP;
+    TCCR1A |= (1 << WGM11);
+    TCCR1B |= (1 << WGM13) | (1 << WGM12);
+#if CLUTCH_DUAL_PWM
+    // COM1x1:0 = 11, inverted on both channels; OCR = TOP is a constant low (value 0)
+    TCCR1A |= (1 << COM1A1) | (1 << COM1A0) | (1 << COM1B1) | (1 << COM1B0);
+    OCR1A = CLUTCH_PWM_TOP;
+    OCR1B = CLUTCH_PWM_TOP;
+#else
     TCCR1A |= (1 << COM1A1);
-    TCCR1B |= (1 << CS10);
     OCR1A = 0;
+#endif
+    TCCR1B |= (1 << CS10);
+#if CLUTCH_DITHER_BITS > 0
+    TIMSK1 |= (1 << TOIE1);
+#endif
     sei();
   }
 
   void setValue(uint16_t value)
   {
     clutchValue = constrain(value, CLUTCH_PWM_MIN, CLUTCH_PWM_MAX);
+#if CLUTCH_DITHER_BITS > 0
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { ditherFrac = 0; }
+#endif
+#if CLUTCH_DUAL_PWM
+    // Both compare registers are double-buffered and latch at BOTTOM. Written back to back
+    // (~1 µs apart), so a split pair is rare and lasts one 16 µs period, far below the RC corner.
+    // Inverted outputs: OCR = TOP - x gives a duty of exactly x / 256, 0 included.
+    OCR1B = CLUTCH_PWM_TOP - (clutchValue & CLUTCH_PWM_TOP);
+    OCR1A = CLUTCH_PWM_TOP - (clutchValue >> CLUTCH_PWM_CHANNEL_BITS);
+#else
     OCR1A = clutchValue;
+#endif
+  }
+
+  // Set from a clutch axis value of axisBits resolution, rescaled to CLUTCH_PWM_BITS
+  // (plus the dither depth, when enabled).
+  void setAxis(uint16_t axis, uint8_t axisBits)
+  {
+#if CLUTCH_DITHER_BITS > 0
+    if (ditherDepth > 0)
+    {
+      uint8_t bits = CLUTCH_PWM_BITS + ditherDepth;
+      uint16_t v = axisBits >= bits ? axis >> (axisBits - bits) : axis << (bits - axisBits);
+      uint16_t base = v >> ditherDepth;
+      uint8_t frac = (uint8_t)((v & ((1 << ditherDepth) - 1)) << (8 - ditherDepth));
+      if (base >= CLUTCH_PWM_MAX)
+      {
+        base = CLUTCH_PWM_MAX;
+        frac = 0;
+      }
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) // read by ditherStep()
+      {
+        clutchValue = base;
+        ditherFrac = frac;
+      }
+      return;
+    }
+#endif
+    if (axisBits >= CLUTCH_PWM_BITS)
+      setValue(axis >> (axisBits - CLUTCH_PWM_BITS));
+    else
+      setValue(axis << (CLUTCH_PWM_BITS - axisBits));
+  }
+
+#if CLUTCH_DITHER_BITS > 0
+  // TIMER1_OVF_vect body, once per carrier period: the 8-bit accumulator's carry adds one
+  // code for frac/256 of the periods. OCR1A is double-buffered, so it applies next period.
+  void ditherStep()
+  {
+    uint8_t sum = ditherAcc + ditherFrac;
+    OCR1A = clutchValue + (sum < ditherAcc ? 1 : 0);
+    ditherAcc = sum;
   }
 
+  // Runtime dither depth, 0 (off) to CLUTCH_DITHER_BITS. Takes effect on the next setAxis().
+  bool setDitherDepth(uint8_t depth)
+  {
+    if (depth > CLUTCH_DITHER_BITS)
+      return false;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      ditherDepth = depth;
+      ditherFrac = 0;
+      if (depth > 0)
+        TIMSK1 |= (1 << TOIE1);
+      else
+        TIMSK1 &= ~(1 << TOIE1);
+    }
+    return true;
+  }
+
+  uint8_t getDitherDepth() { return ditherDepth; }
+#endif
+
   uint16_t getValue()
   {
     return clutchValue;
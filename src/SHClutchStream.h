@@ -0,0 +1,188 @@
+#ifndef __SHCLUTCHSTREAM_H__
+#define __SHCLUTCHSTREAM_H__
+
+#include <Arduino.h>
+#include <util/atomic.h>
+#include "RingBuffer.h"
+#include "SHDualClutchSensor.h"
+
+// Binary clutch stream: A/B samples at up to the sensor rate (one pair every
+// CLUTCH_SAMPLE_PERIOD_US, ~290 Hz) for looking at paddle release dynamics.
+//
+// The input-plane tick captures every <decimation>-th sample of the selected pipeline stage
+// (raw, filtered or calibrated, axis units) into a ring. A main-loop task drains the ring
+// into CustomPacket frames of type CLUTCH_STREAM_PACKET, never writing more than the UART
+// TX buffer has room for, so the stream cannot stall the serial loop — when the link falls
+// behind, the ring overflows and samples are dropped (visible as a gap in the index).
+// A packet only goes out once CLUTCH_STREAM_BATCH samples are queued or the oldest has
+// waited CLUTCH_STREAM_MAX_AGE_MS: sent one at a time, every sample would pay the 3-byte
+// header and a 3-byte keyframe (8 bytes, ~2.3 kB/s at full rate — more than the link).
+//
+// Packet payload:
+//   [0] index    low byte of the capture counter of the first sample (counts dropped ones too)
+//   [1] flags    bits 0-1 stage, bit 7 delta encoding
+//   [2-4]        first sample, absolute: A bits 0-11, B bits 12-23, little endian
+//   then, per further consecutive sample:
+//     delta:     int8 ΔA, int8 ΔB against the previous sample (2 bytes)
+//     absolute:  3 bytes as above
+// A delta that does not fit int8, or a gap in the index, ends the packet; the next packet
+// starts with an absolute keyframe.
+//
+// Budget at 19200 baud (~1900 B/s, shared with everything else), decimation 1, batches of 8:
+//   delta     3 + 5 + 7 × 2 = 22 bytes per 8 samples → ~800 B/s
+//   absolute  3 + 5 + 7 × 3 = 29 bytes per 8 samples → ~1050 B/s
+// A step that does not fit int8 (a fast release moves ~400 counts per sample) ends the
+// packet, so during such a move delta falls back towards 8 bytes per sample and the ring
+// drops samples. Use decimation ≥ 2 alongside other traffic.
+
+#define CLUTCH_STREAM_PACKET     0x10
+#define CLUTCH_STREAM_QUEUE      32     // captured samples (~55 ms at full rate)
+#define CLUTCH_STREAM_MAX_FRAME  32     // payload bytes per packet
+#define CLUTCH_STREAM_BATCH      8      // queued samples before a packet is sent
+#define CLUTCH_STREAM_MAX_AGE_MS 50     // ... or once the oldest has waited this long
+#define CLUTCH_STREAM_FLAG_DELTA 0x80
+#define CLUTCH_STREAM_STAGE_MASK 0x03
+
+class SHClutchStream
+{
+private:
+	// Queued sample: A bits 0-11, B bits 12-23, capture index bits 24-31
+	RingBuffer<uint32_t, CLUTCH_STREAM_QUEUE> _queue;
+	uint8_t _decimation = 0;   // 0 = off
+	uint8_t _countdown = 0;
+	uint8_t _flags = 0;
+	uint8_t _index = 0;
+	uint32_t _pending = 0;     // sample popped but not yet sent (didn't fit the last packet)
+	bool _hasPending = false;
+	bool _waiting = false;     // samples queued since _waitingSince
+	unsigned long _waitingSince = 0;
+
+	static void putAbsolute(uint8_t* p, uint32_t s)
+	{
+		p[0] = (uint8_t)s;
+		p[1] = (uint8_t)(s >> 8);
+		p[2] = (uint8_t)(s >> 16);
+	}
+
+	bool next(uint32_t& s)
+	{
+		if (_hasPending)
+		{
+			s = _pending;
+			_hasPending = false;
+			return true;
+		}
+		return _queue.lockedPop(s);
+	}
+
+public:
+	// Host side: decimation 0 stops the stream. stage is one of SHDualClutchSensor::STAGE_*.
+	// Returns false for an invalid stage.
+	bool configure(uint8_t decimation, uint8_t stage, bool delta)
+	{
+		if (stage > SHDualClutchSensor::STAGE_CALIBRATED)
+			return false;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			_decimation = decimation;
+			_countdown = 1;
+			_flags = stage | (delta ? CLUTCH_STREAM_FLAG_DELTA : 0);
+			uint32_t s;
+			while (_queue.pop(s)) {}
+		}
+		_hasPending = false;
+		_waiting = false;
+		return true;
+	}
+
+	bool active() const { return _decimation != 0; }
+
+	// Tick side: called after every clutch sample.
+	void capture(const SHDualClutchSensor& sensor)
+	{
+		if (_decimation == 0 || --_countdown)
+			return;
+		_countdown = _decimation;
+		uint8_t stage = _flags & CLUTCH_STREAM_STAGE_MASK;
+		uint32_t s = (uint32_t)(sensor.stageValue(stage, 0) & 0x0FFF)
+			| ((uint32_t)(sensor.stageValue(stage, 1) & 0x0FFF) << 12)
+			| ((uint32_t)_index << 24);
+		_index++;
+		_queue.lockedPush(s); // full → dropped, the host sees the index gap
+	}
+
+	// Main-loop side: send one packet once a batch is queued (or the oldest sample is due)
+	// and the UART has room for it.
+	void service(unsigned long now)
+	{
+		if (_decimation == 0)
+			return;
+		uint8_t queued;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			queued = _queue.size();
+		}
+		queued += _hasPending;
+		if (queued == 0)
+		{
+			_waiting = false;
+			return;
+		}
+		if (!_waiting)
+		{
+			_waiting = true;
+			_waitingSince = now;
+		}
+		if (queued < CLUTCH_STREAM_BATCH && now - _waitingSince < CLUTCH_STREAM_MAX_AGE_MS)
+			return;
+		int room = Serial.availableForWrite() - 3; // 0x09, type, length
+		if (room < 5)
+			return;
+		uint8_t limit = room < CLUTCH_STREAM_MAX_FRAME ? room : CLUTCH_STREAM_MAX_FRAME;
+
+		uint32_t s;
+		if (!next(s))
+			return;
+		uint8_t frame[CLUTCH_STREAM_MAX_FRAME];
+		bool delta = _flags & CLUTCH_STREAM_FLAG_DELTA;
+		frame[0] = (uint8_t)(s >> 24);
+		frame[1] = _flags;
+		putAbsolute(frame + 2, s);
+		uint8_t len = 5;
+
+		uint32_t prev = s;
+		while (len + (delta ? 2 : 3) <= limit && next(s))
+		{
+			bool fits = (uint8_t)(s >> 24) == (uint8_t)((prev >> 24) + 1);
+			int16_t dA = (int16_t)(s & 0x0FFF) - (int16_t)(prev & 0x0FFF);
+			int16_t dB = (int16_t)((s >> 12) & 0x0FFF) - (int16_t)((prev >> 12) & 0x0FFF);
+			if (delta)
+				fits = fits && dA >= -128 && dA <= 127 && dB >= -128 && dB <= 127;
+			if (!fits)
+			{
+				_pending = s;
+				_hasPending = true;
+				break;
+			}
+			if (delta)
+			{
+				frame[len++] = (uint8_t)(int8_t)dA;
+				frame[len++] = (uint8_t)(int8_t)dB;
+			}
+			else
+			{
+				putAbsolute(frame + len, s);
+				len += 3;
+			}
+			prev = s;
+		}
+
+		arqserial.CustomPacketStart(CLUTCH_STREAM_PACKET, len);
+		for (uint8_t i = 0; i < len; i++)
+			arqserial.CustomPacketSendByte(frame[i]);
+		arqserial.CustomPacketEnd();
+		_waitingSince = now; // what is left over starts a new wait
+	}
+};
+
+#endif
@@ -101,31 +101,56 @@ void Command_GLCDData() {
 
 void Command_ExpandedCommandsList() {
 #ifdef INCLUDE_SPEEDOGAUGE
-	FlowSerialPrintLn("speedo");
+	FlowSerialPrintLn(F("speedo"));
 #endif
 #ifdef INCLUDE_TACHOMETER
-	FlowSerialPrintLn("tachometer");
+	FlowSerialPrintLn(F("tachometer"));
 #endif
 #ifdef INCLUDE_BOOSTGAUGE
-	FlowSerialPrintLn("boostgauge");
+	FlowSerialPrintLn(F("boostgauge"));
 #endif
 #ifdef INCLUDE_TEMPGAUGE
-	FlowSerialPrintLn("tempgauge");
+	FlowSerialPrintLn(F("tempgauge"));
 #endif
 #ifdef INCLUDE_FUELGAUGE
-	FlowSerialPrintLn("fuelgauge");
+	FlowSerialPrintLn(F("fuelgauge"));
 #endif
 #ifdef INCLUDE_CONSGAUGE
-	FlowSerialPrintLn("consumptiongauge");
+	FlowSerialPrintLn(F("consumptiongauge"));
 #endif
 #ifdef INCLUDE_DM163_MATRIX
-	FlowSerialPrintLn("dm163rgb");
+	FlowSerialPrintLn(F("dm163rgb"));
 #endif
 #if ENABLED_ENCODERS_COUNT > 0
-	FlowSerialPrintLn("encoders");
+	FlowSerialPrintLn(F("encoders"));
+#endif
+	FlowSerialPrintLn(F("route"));
+	FlowSerialPrintLn(F("ladder"));
+	FlowSerialPrintLn(F("ladderreset"));
+	FlowSerialPrintLn(F("sched"));
+	FlowSerialPrintLn(F("clutchbench"));
+	FlowSerialPrintLn(F("clutchfilter"));
+	FlowSerialPrintLn(F("clutchprofile"));
+	FlowSerialPrintLn(F("clutchcurve"));
+	FlowSerialPrintLn(F("clutchstream"));
+	FlowSerialPrintLn(F("clutchcal"));
+	FlowSerialPrintLn(F("clutchcalstate"));
+	FlowSerialPrintLn(F("launch"));
+	FlowSerialPrintLn(F("launchcfg"));
+	FlowSerialPrintLn(F("linkstats"));
+	FlowSerialPrintLn(F("mem"));
+#ifdef INCLUDE_WS2812B
+	FlowSerialPrintLn(F("ledfx"));
+	FlowSerialPrintLn(F("ledfxcfg"));
+#endif
+#if CLUTCH_DITHER_BITS > 0
+	FlowSerialPrintLn(F("clutchdither"));
+#endif
+#if CLUTCH_LATENCY_PROBE
+	FlowSerialPrintLn(F("clutchlat"));
 #endif
-	FlowSerialPrintLn("mcutype");
-	FlowSerialPrintLn("keepalive");
+	FlowSerialPrintLn(F("mcutype"));
+	FlowSerialPrintLn(F("keepalive"));
 	FlowSerialPrintLn();
 	FlowSerialFlush();
 }
@@ -316,6 +341,35 @@ void Command_RGBLEDSCount() {
 	FlowSerialFlush();
 }
 
+// Show function handed to shLedCommit: latches whatever read() left pending.
+void ShowRGBLeds()
+{
+#ifdef INCLUDE_WS2812B
+	shRGBLedsWS2812B.commit();
+#endif
+}
+
+// Safe-slot commit for any command that changed the strip, called just before its ack.
+void CommitRGBLeds()
+{
+#ifdef INCLUDE_WS2812B
+	if (shRGBLedsWS2812B.dirty())
+		shLedCommit.commit(ShowRGBLeds);
+	else
+		shLedCommit.unchanged();
+#endif
+}
+
+// Safe slot of a command that carries no LED data: presents a frame held back by pacing
+// or a deferral, so it does not wait for the next LED command or a quiet link.
+void PresentPendingRGBLeds()
+{
+#ifdef INCLUDE_WS2812B
+	if (shRGBLedsWS2812B.dirty())
+		shLedCommit.commit(ShowRGBLeds);
+#endif
+}
+
 void Command_RGBLEDSData()
 {
 #ifdef INCLUDE_WS2812B
@@ -327,9 +381,8 @@ void Command_RGBLEDSData()
 #ifdef INCLUDE_WS2801
 	shRGBLedsWS2801.read();
 #endif
-#ifdef INCLUDE_WS2812B
-	shRGBLedsWS2812B.show();
-#endif
+	// Host is waiting for the ack: the one slot where an interrupts-off show loses no RX bytes
+	CommitRGBLeds();
 #ifdef INCLUDE_WS2801
 	shRGBLedsWS2801.show();
 #endif
@@ -400,5 +453,6 @@ void Command_I2CLCDData() {
 
 void Command_CustomProtocolData() {
 	shCustomProtocol.read();
+	PresentPendingRGBLeds();
 	FlowSerialWrite(0x15);
 }
@@ -0,0 +1,459 @@
+// Project-specific Xpanded commands (X <name>), dispatched from loop() in main.cpp.
+
+// X route <12 bytes> — replace the ROT1 routing table in one frame.
+// One byte per position 1-12, layout as ROUTE_* in ExpandedInputsPreProcessor.h.
+// Replies 0x15 when applied, 0x00 when any entry was rejected (table left untouched).
+void Command_RoutingTable() {
+	uint8_t table[ROT1_POSITIONS];
+	for (uint8_t i = 0; i < ROT1_POSITIONS; i++) {
+		table[i] = (uint8_t)FlowSerialTimedRead();
+	}
+	FlowSerialWrite(expandedInputs.setRoutingTable(table) ? 0x15 : 0x00);
+}
+
+// X ladder — dump the learned rotary ladder thresholds, one line per channel:
+//   LAD<n>:<11 boundaries, pos1|2 … pos11|12>;H:<hysteresis>;SRC:<EEPROM|DEFAULT>
+void Command_LadderDump() {
+	SHRotaryLadder& ladder = expandedInputs.getLadder();
+	for (uint8_t ch = 0; ch < LADDER_CHANNELS; ch++) {
+		SHLongMessage m;
+		m.key(F("LAD")).num((uint8_t)(ch + 1)).ch(':');
+		for (uint8_t pos = 1; pos < LADDER_POSITIONS; pos++) {
+			if (pos > 1) m.ch(',');
+			m.num(ladder.boundary(ch, pos));
+		}
+		m.key(F(";H:")).num(ladder.hysteresis(ch));
+		m.key(ladder.isStored(ch) ? F(";SRC:EEPROM") : F(";SRC:DEFAULT"));
+		FlowSerialPrintLn(m);
+	}
+	FlowSerialPrintLn();
+	FlowSerialFlush();
+}
+
+// X ladderreset — discard learned levels, back to the factory ladder (persisted by the persist task).
+void Command_LadderReset() {
+	expandedInputs.getLadder().reset();
+	FlowSerialWrite(0x15);
+}
+
+// X sched — per-task scheduler statistics since the previous X sched, one line per task:
+//   SCH:<name>;P:<period ms>;D:<deadline ms>;OVR:<overruns>;LATE:<max release lateness ms>
+// followed by the input-plane tick and the registrations that found the table full:
+//   ISR:<max tick µs>;SKIP:<ticks skipped>;DROP:<queued button events lost>;REJ:<tasks not added>
+// Statistics are cleared after the dump (REJ is fixed at boot).
+void Command_SchedulerStats() {
+	SHMessage m;
+	for (uint8_t i = 0; i < shScheduler.count(); i++) {
+		m.clear();
+		m.key(F("SCH:")).key(shScheduler.name(i));
+		m.key(F(";P:")).num(shScheduler.period(i));
+		m.key(F(";D:")).num(shScheduler.deadline(i));
+		m.key(F(";OVR:")).num(shScheduler.overruns(i));
+		m.key(F(";LATE:")).num(shScheduler.maxLateness(i));
+		FlowSerialPrintLn(m);
+	}
+	m.clear();
+	m.key(F("ISR:")).num(shInputPlane.maxTickUs());
+	m.key(F(";SKIP:")).num(shInputPlane.skippedTicks());
+	m.key(F(";DROP:")).num(shInputPlane.droppedEvents());
+	m.key(F(";REJ:")).num(shScheduler.rejected());
+	FlowSerialPrintLn(m);
+	FlowSerialPrintLn();
+	FlowSerialFlush();
+	shScheduler.resetStats();
+	shInputPlane.resetStats();
+}
+
+// X clutchbench — compare the fixed-point clutch combination against the original double
+// formula on the full CLUTCH_AXIS_BITS axis. Checks a grid of inputs for the worst
+// difference: A/B in 16 steps from 0 to CLUTCH_AXIS_MAX, and bite points every 0.7 % plus
+// 100 %. The 0.7 % step is not a divisor of 1000, so the sweep covers Q16 weights that
+// need rounding; a step like 12.5 % only hits exact multiples of 1/8. Then times both on
+// the same inputs. Blocks for about two seconds.
+//   CBN:N:<evaluations>;MAXERR:<worst |fixed - reference| in LSB>;REF:<cycles/call>;FIX:<cycles/call>
+// followed by the per-sample calibration, map() + constrain() against Q16 scale + curve LUT
+// (channel A's calibration and the active curve):
+//   CBC:MAP:<cycles/call>;LUT:<cycles/call>
+void Command_ClutchBench() {
+	const uint8_t TIMED_CALLS = 64;
+	volatile uint16_t sink = 0;
+	uint16_t maxErr = 0;
+	uint16_t evaluations = 0;
+
+	const uint16_t AXIS_STEP = CLUTCH_AXIS_MAX / 15;  // 273 at 12 bits: 0 … 4095 exactly
+	for (uint16_t bp = 0; ; bp += 7) {
+		if (bp > CLUTCH_BP_MAX) bp = CLUTCH_BP_MAX;
+		uint32_t weight = clutchBiteWeightQ16(bp);
+		for (uint16_t a = 0; a <= CLUTCH_AXIS_MAX; a += AXIS_STEP) {
+			for (uint16_t b = 0; b <= CLUTCH_AXIS_MAX; b += AXIS_STEP) {
+				int16_t err = (int16_t)clutchCombineReference(a, b, bp, CLUTCH_AXIS_MAX) - (int16_t)clutchCombineQ16(a, b, weight);
+				if (err < 0) err = -err;
+				if ((uint16_t)err > maxErr) maxErr = err;
+				evaluations++;
+			}
+		}
+		if (bp == CLUTCH_BP_MAX) break;
+	}
+
+	uint32_t weight = clutchBiteWeightQ16(shCustomProtocol.getClutchBitePoint());
+	unsigned long start = micros();
+	for (uint8_t i = 0; i < TIMED_CALLS; i++)
+		sink = clutchCombineReference(i * 64, CLUTCH_AXIS_MAX - i * 64, shCustomProtocol.getClutchBitePoint(), CLUTCH_AXIS_MAX);
+	unsigned long refUs = micros() - start;
+	start = micros();
+	for (uint8_t i = 0; i < TIMED_CALLS; i++)
+		sink = clutchCombineQ16(i * 64, CLUTCH_AXIS_MAX - i * 64, weight);
+	unsigned long fixUs = micros() - start;
+	(void)sink;
+
+	SHMessage m;
+	m.key(F("CBN:N:")).num(evaluations);
+	m.key(F(";MAXERR:")).num(maxErr);
+	m.key(F(";REF:")).num((uint32_t)(refUs * (F_CPU / 1000000UL) / TIMED_CALLS));
+	m.key(F(";FIX:")).num((uint32_t)(fixUs * (F_CPU / 1000000UL) / TIMED_CALLS));
+	FlowSerialPrintLn(m);
+
+	start = micros();
+	for (uint8_t i = 0; i < TIMED_CALLS; i++)
+		sink = SHDualClutchSensor::applyCalibrationReference(i * 64, 600 << CLUTCH_OVERSAMPLE_BITS, 950 << CLUTCH_OVERSAMPLE_BITS);
+	unsigned long mapUs = micros() - start;
+	start = micros();
+	for (uint8_t i = 0; i < TIMED_CALLS; i++)
+		sink = shDualClutchSensor.calibrate(0, i * 64);
+	unsigned long lutUs = micros() - start;
+	m.clear();
+	m.key(F("CBC:MAP:")).num((uint32_t)(mapUs * (F_CPU / 1000000UL) / TIMED_CALLS));
+	m.key(F(";LUT:")).num((uint32_t)(lutUs * (F_CPU / 1000000UL) / TIMED_CALLS));
+	FlowSerialPrintLn(m);
+	FlowSerialPrintLn();
+	FlowSerialFlush();
+}
+
+// X clutchfilter <channel> <type> <p1> <p2> — select a clutch filter at runtime (4 bytes).
+// channel 0 = A, 1 = B, 2 = both; type/p1/p2 as CLUTCH_FILTER_* in SHClutchFilter.h.
+// Replies 0x15 when applied, 0x00 when rejected (current filter kept).
+void Command_ClutchFilter() {
+	uint8_t channel = (uint8_t)FlowSerialTimedRead();
+	uint8_t type = (uint8_t)FlowSerialTimedRead();
+	uint8_t p1 = (uint8_t)FlowSerialTimedRead();
+	uint8_t p2 = (uint8_t)FlowSerialTimedRead();
+	bool ok = channel <= 2;
+	if (ok && channel != 1) ok = shDualClutchSensor.setFilter(0, type, p1, p2);
+	if (ok && channel != 0) ok = shDualClutchSensor.setFilter(1, type, p1, p2);
+	FlowSerialWrite(ok ? 0x15 : 0x00);
+}
+
+// X clutchprofile — active clutch filters and their measured behaviour, one line per channel:
+//   CFP<A|B>:T:<NONE|SMA|IIR|EURO>;P1:;P2:;GD:<theoretical group delay µs>;LAG:<measured lag µs|->;NIN:;NOUT:
+// NIN/NOUT are input/output peak-to-peak (axis counts) over the last 256 samples — hold the lever
+// still to read noise. LAG is from the last window in which the lever travelled; '-' until then.
+void Command_ClutchProfile() {
+	static const char names[][5] PROGMEM = { "NONE", "SMA", "IIR", "EURO" };
+	for (uint8_t ch = 0; ch < 2; ch++) {
+		uint8_t type, p1, p2;
+		uint16_t gd, lag, nin, nout;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			const SHClutchFilter& f = shDualClutchSensor.getFilter(ch);
+			type = f.type();
+			p1 = f.p1();
+			p2 = f.p2();
+			gd = f.groupDelayX16();
+			lag = f.lagX16();
+			nin = f.noiseIn();
+			nout = f.noiseOut();
+		}
+		SHMessage m;
+		m.key(ch == 0 ? F("CFPA:T:") : F("CFPB:T:")).key(names[type]);
+		m.key(F(";P1:")).num(p1);
+		m.key(F(";P2:")).num(p2);
+		m.key(F(";GD:")).num((uint32_t)gd * CLUTCH_SAMPLE_PERIOD_US / 16);
+		m.key(F(";LAG:"));
+		if (lag == 0xFFFF) m.ch('-');
+		else m.num((uint32_t)lag * CLUTCH_SAMPLE_PERIOD_US / 16);
+		m.key(F(";NIN:")).num(nin);
+		m.key(F(";NOUT:")).num(nout);
+		FlowSerialPrintLn(m);
+	}
+	FlowSerialPrintLn();
+	FlowSerialFlush();
+}
+
+// X clutchcurve — the active clutch response curve, knots in permille of travel:
+//   CRV:<k0,k1,…,k16>;SRC:<EEPROM|DEFAULT>
+void Command_ClutchCurve() {
+	SHClutchCurve& curve = shDualClutchSensor.getCurve();
+	SHLongMessage m;
+	m.key(F("CRV:"));
+	for (uint8_t i = 0; i < CLUTCH_CURVE_KNOTS; i++) {
+		if (i > 0) m.ch(',');
+		m.num(curve.permille(i));
+	}
+	m.key(curve.isStored() ? F(";SRC:EEPROM") : F(";SRC:DEFAULT"));
+	FlowSerialPrintLn(m);
+	FlowSerialPrintLn();
+	FlowSerialFlush();
+}
+
+// X clutchstream <decimation> <stage> <flags> — start/stop the binary clutch stream (3 bytes).
+// decimation 0 = off, n = every n-th sample; stage 0 raw, 1 filtered, 2 calibrated;
+// flags bit 0 = delta encoding. Packets are CustomPacket 0x10, see SHClutchStream.h.
+// Replies 0x15 when applied, 0x00 when rejected.
+void Command_ClutchStream() {
+	uint8_t decimation = (uint8_t)FlowSerialTimedRead();
+	uint8_t stage = (uint8_t)FlowSerialTimedRead();
+	uint8_t flags = (uint8_t)FlowSerialTimedRead();
+	FlowSerialWrite(shClutchStream.configure(decimation, stage, flags & 0x01) ? 0x15 : 0x00);
+}
+
+// X clutchcal <action> — on-device calibration capture (1 byte):
+//   0 start (paddles released), 1 commit (after sweeping both fully; saved to EEPROM), 2 abort.
+// Replies 0x15 when done, 0x00 when rejected (commit with a paddle not swept keeps capturing).
+void Command_ClutchCal() {
+	uint8_t action = (uint8_t)FlowSerialTimedRead();
+	bool ok = true;
+	if (action == 0)
+		shDualClutchSensor.beginCapture();
+	else if (action == 1)
+		ok = shDualClutchSensor.commitCapture();
+	else if (action == 2)
+		shDualClutchSensor.abortCapture();
+	else
+		ok = false;
+	FlowSerialWrite(ok ? 0x15 : 0x00);
+}
+
+// X clutchcalstate — active calibration and capture progress:
+//   CAL:ST:<IDLE|CAPTURE>;SRC:<DEFAULT|EEPROM|HOST>;RA:;FA:;RB:;FB:[;A:<min>-<max>;B:<min>-<max>]
+void Command_ClutchCalState() {
+	static const char sources[][8] PROGMEM = { "DEFAULT", "EEPROM", "HOST" };
+	const uint16_t* cal = shDualClutchSensor.getCalibration();
+	bool capturing = shDualClutchSensor.isCapturing();
+	SHMessage m;
+	m.key(capturing ? F("CAL:ST:CAPTURE") : F("CAL:ST:IDLE"));
+	m.key(F(";SRC:")).key(sources[shDualClutchSensor.getCalibrationSource()]);
+	m.key(F(";RA:")).num(cal[0]);
+	m.key(F(";FA:")).num(cal[1]);
+	m.key(F(";RB:")).num(cal[2]);
+	m.key(F(";FB:")).num(cal[3]);
+	if (capturing) {
+		uint16_t lo, hi;
+		shDualClutchSensor.getCapture(0, lo, hi);
+		m.key(F(";A:")).num(lo).ch('-').num(hi);
+		shDualClutchSensor.getCapture(1, lo, hi);
+		m.key(F(";B:")).num(lo).ch('-').num(hi);
+	}
+	FlowSerialPrintLn(m);
+	FlowSerialPrintLn();
+	FlowSerialFlush();
+}
+
+// X launch — launch flight recorder (SHLaunchRecorder.h):
+//   LCH:ST:<IDLE|ARMED|REC|DONE>;TRIG:<%>;BAND:<%>;BP:<tenths>;REL:<ms>;DWELL:<ms>;OVS:<permille>;FULL:<ms>
+// REL/FULL are '-' when not reached. Once DONE, the trace follows and the recorder re-arms:
+//   LCT:<entry interval µs>;N:<entries>;TRIG:<index of the trigger entry>
+//   LCD:<AABBCC hex per entry, 16 per line> …
+void Command_Launch() {
+	static const char states[][6] PROGMEM = { "IDLE", "ARMED", "REC", "DONE" };
+	uint8_t state = shLaunchRecorder.state();
+	uint16_t bp, release, dwell, overshoot, full;
+	shLaunchRecorder.metrics(bp, release, dwell, overshoot, full);
+	release = SHLaunchRecorder::toMs(release);
+	full = SHLaunchRecorder::toMs(full);
+
+	SHMessage m;
+	m.key(F("LCH:ST:")).key(states[state]);
+	m.key(F(";TRIG:")).num(shLaunchRecorder.triggerPct());
+	m.key(F(";BAND:")).num(shLaunchRecorder.bandPct());
+	m.key(F(";BP:")).num(bp);
+	m.key(F(";REL:")).numOr(release, LAUNCH_NOT_REACHED);
+	m.key(F(";DWELL:")).num(SHLaunchRecorder::toMs(dwell));
+	m.key(F(";OVS:")).num(overshoot);
+	m.key(F(";FULL:")).numOr(full, LAUNCH_NOT_REACHED);
+	FlowSerialPrintLn(m);
+
+	if (state == LAUNCH_DONE) {
+		uint8_t n = shLaunchRecorder.count();
+		m.clear();
+		m.key(F("LCT:")).num((uint32_t)LAUNCH_TRACE_DECIMATION * CLUTCH_SAMPLE_PERIOD_US);
+		m.key(F(";N:")).num(n);
+		m.key(F(";TRIG:")).num((int16_t)(n - (LAUNCH_TRACE_ENTRIES - LAUNCH_TRACE_PRE)));
+		FlowSerialPrintLn(m);
+		for (uint8_t i = 0; i < n; i += 16) {
+			SHLongMessage row;
+			row.key(F("LCD:"));
+			for (uint8_t j = i; j < n && j < i + 16; j++) {
+				const uint8_t* e = shLaunchRecorder.entry(j);
+				for (uint8_t k = 0; k < 3; k++)
+					row.hex8(e[k]);
+			}
+			FlowSerialPrintLn(row);
+		}
+		shLaunchRecorder.rearm();
+	}
+	FlowSerialPrintLn();
+	FlowSerialFlush();
+}
+
+// X launchcfg <trigger %> <band %> — recorder trigger level and bite-zone half-width (2 bytes).
+// Re-arms the recorder. Replies 0x15 when applied, 0x00 when out of range.
+void Command_LaunchConfig() {
+	uint8_t triggerPct = (uint8_t)FlowSerialTimedRead();
+	uint8_t bandPct = (uint8_t)FlowSerialTimedRead();
+	FlowSerialWrite(shLaunchRecorder.configure(triggerPct, bandPct) ? 0x15 : 0x00);
+}
+
+// X linkstats — serial link health since the previous X linkstats (ArqSerial.h, SHLedCommit.h):
+//   LNK:PKT:<packets acked>;BYTES:<payload>;NAK:<total>;R1..R5:<per reason>;FULL:<RX ring full>;ERR:<NAK per mille of packets>
+//   LED:SHOW:<safe-slot shows>;DEFER:<slots skipped, bytes in flight>;PACE:<slots held back by LED_PRESENT_HZ>;
+//       QUIET:<deferred shows>;SAME:<unchanged frames>;MAXUS:<longest show>;OFFMS:<total show time>
+// Every dropped byte surfaces as a NAck and a resend, so ERR is the rate to watch when
+// raising the baud rate. Statistics are cleared after the dump.
+void Command_LinkStats() {
+	uint16_t nacks = 0;
+	for (uint8_t r = 1; r <= 5; r++)
+		nacks += arqserial.nacks(r);
+	uint32_t frames = (uint32_t)arqserial.packets() + nacks;
+	SHMessage m;
+	m.key(F("LNK:PKT:")).num(arqserial.packets());
+	m.key(F(";BYTES:")).num(arqserial.payloadBytes());
+	m.key(F(";NAK:")).num(nacks);
+	for (uint8_t r = 1; r <= 5; r++)
+		m.key(F(";R")).num(r).ch(':').num(arqserial.nacks(r));
+	m.key(F(";FULL:")).num(arqserial.rxFullEvents());
+	m.key(F(";ERR:")).num((uint16_t)(frames ? (uint32_t)nacks * 1000 / frames : 0));
+	FlowSerialPrintLn(m);
+	m.clear();
+	m.key(F("LED:SHOW:")).num(shLedCommit.shows());
+	m.key(F(";DEFER:")).num(shLedCommit.deferred());
+	m.key(F(";PACE:")).num(shLedCommit.pacedSlots());
+	m.key(F(";QUIET:")).num(shLedCommit.quietShows());
+	m.key(F(";SAME:")).num(shLedCommit.unchangedFrames());
+	m.key(F(";MAXUS:")).num(shLedCommit.maxShowUs());
+	m.key(F(";OFFMS:")).num(shLedCommit.showUs() / 1000);
+	FlowSerialPrintLn(m);
+	FlowSerialPrintLn();
+	FlowSerialFlush();
+	arqserial.resetStats();
+	shLedCommit.resetStats();
+}
+
+static void memModule(const __FlashStringHelper* name, uint16_t bytes) {
+	SHMessage m;
+	m.key(F("RAM:")).key(name).key(F(";B:")).num(bytes);
+	FlowSerialPrintLn(m);
+}
+
+// X mem — RAM usage and high-water marks (SHMemory.h), in bytes:
+//   MEM:STATIC:<.data+.bss>;HEAP:<now>;HEAPMAX:<peak>;FREE:<heap top to SP>
+//   STK:NOW:<depth>;MAX:<deepest since boot>;GAP:<never touched between the two peaks>
+//   FL:N:<free-list blocks>;BYTES:<free-list total>;MAX:<largest block>
+// then the static footprint of the main objects, one line each:
+//   RAM:<name>;B:<sizeof>
+// Built with SHMessage so that the report does not itself allocate from the heap.
+extern InputSnapshotBuffer inputSnapshots;
+void Command_Mem() {
+	shMemory.sample();
+	SHMessage m;
+	m.key(F("MEM:STATIC:")).num(SHMemory::staticBytes());
+	m.key(F(";HEAP:")).num(SHMemory::heapBytes());
+	m.key(F(";HEAPMAX:")).num(shMemory.heapMax());
+	m.key(F(";FREE:")).num(SHMemory::freeBytes());
+	FlowSerialPrintLn(m);
+	m.clear();
+	m.key(F("STK:NOW:")).num(SHMemory::stackBytes());
+	m.key(F(";MAX:")).num(shMemory.stackMax());
+	m.key(F(";GAP:")).num(shMemory.untouched());
+	FlowSerialPrintLn(m);
+	SHMemory::FreeList fl = SHMemory::freeList();
+	m.clear();
+	m.key(F("FL:N:")).num(fl.blocks).key(F(";BYTES:")).num(fl.bytes).key(F(";MAX:")).num(fl.largest);
+	FlowSerialPrintLn(m);
+	memModule(F("arqserial"), sizeof(arqserial));
+	memModule(F("protocol"), sizeof(shCustomProtocol));
+	memModule(F("scheduler"), sizeof(shScheduler));
+	memModule(F("inputplane"), sizeof(shInputPlane));
+	memModule(F("inputs"), sizeof(expandedInputs));
+	memModule(F("snapshots"), sizeof(inputSnapshots));
+	memModule(F("clutchpwm"), sizeof(shClutchPWM));
+	memModule(F("clutch"), sizeof(shDualClutchSensor));
+	memModule(F("stream"), sizeof(shClutchStream));
+	memModule(F("launch"), sizeof(shLaunchRecorder));
+#if CLUTCH_LATENCY_PROBE
+	memModule(F("latency"), sizeof(shLatencyProbe));
+#endif
+#ifdef INCLUDE_WS2812B
+	memModule(F("leds"), sizeof(shRGBLedsWS2812B));
+	memModule(F("ledcommit"), sizeof(shLedCommit));
+	memModule(F("ledfx"), sizeof(shLedFx));
+#endif
+	FlowSerialPrintLn();
+	FlowSerialFlush();
+}
+
+#ifdef INCLUDE_WS2812B
+// X ledfx <rpm %><flags><status> — effect-engine telemetry (3 bytes, SHLedFx.h). Renders the
+// frame and shows it before the ack, the same safe slot as the '6' command. Replies 0x15.
+void ledFxPixel(uint8_t led, uint8_t r, uint8_t g, uint8_t b);
+void Command_LedFx() {
+	uint8_t rpm = (uint8_t)FlowSerialTimedRead();
+	uint8_t flags = (uint8_t)FlowSerialTimedRead();
+	uint8_t status = (uint8_t)FlowSerialTimedRead();
+	unsigned long now = millis();
+	shLedFx.telemetry(rpm, flags, status, now);
+	shLedFx.render(now, ledFxPixel);
+	CommitRGBLeds();
+	FlowSerialWrite(0x15);
+}
+
+// X ledfxcfg <20 bytes> — effect layout (SHLedFx::Config): bar first/count, rpm start/shift %,
+// flag first/count, DRS first/count, 3 bar zone colours and the limiter colour (RGB).
+// Saved to EEPROM. Replies 0x15 when applied, 0x00 when a segment leaves the strip.
+void Command_LedFxConfig() {
+	SHLedFx::Config c;
+	uint8_t* p = (uint8_t*)&c;
+	for (uint8_t i = 0; i < sizeof(c); i++)
+		p[i] = (uint8_t)FlowSerialTimedRead();
+	FlowSerialWrite(shLedFx.configure(c) ? 0x15 : 0x00);
+}
+#endif
+
+#if CLUTCH_DITHER_BITS > 0
+// X clutchdither <depth> — sigma-delta dither depth of the clutch PWM (1 byte, 0 = off,
+// max CLUTCH_DITHER_BITS). Replies 0x15 when applied, 0x00 when out of range.
+void Command_ClutchDither() {
+	uint8_t depth = (uint8_t)FlowSerialTimedRead();
+	FlowSerialWrite(shClutchPWM.setDitherDepth(depth) ? 0x15 : 0x00);
+}
+#endif
+
+#if CLUTCH_LATENCY_PROBE
+// X clutchlat — clutch sample → OCR1A latency since the previous X clutchlat (SHLatencyProbe.h):
+//   LAT:<WAIT|FILT|COMB|PWM|TOTAL>;MIN:<µs>;AVG:<µs>;MAX:<µs>
+//   LATH:<bin µs>;<16 bin counts of TOTAL, last bin open-ended>;N:<samples>
+// WAIT = ADC done → tick pickup, FILT = filter + calibration, COMB = combine, PWM = OCR1A write.
+// Statistics are cleared after the dump.
+void Command_ClutchLatency() {
+	static const char names[LATENCY_SEGMENTS][6] PROGMEM = { "WAIT", "FILT", "COMB", "PWM", "TOTAL" };
+	for (uint8_t i = 0; i < LATENCY_SEGMENTS; i++) {
+		uint16_t minUs, avgUs, maxUs;
+		shLatencyProbe.segment(i, minUs, avgUs, maxUs);
+		SHMessage m;
+		m.key(F("LAT:")).key(names[i]);
+		m.key(F(";MIN:")).num(minUs);
+		m.key(F(";AVG:")).num(avgUs);
+		m.key(F(";MAX:")).num(maxUs);
+		FlowSerialPrintLn(m);
+	}
+	SHLongMessage m;
+	m.key(F("LATH:")).num((uint16_t)(1 << LATENCY_HIST_SHIFT)).ch(';');
+	for (uint8_t i = 0; i < LATENCY_HIST_BINS; i++) {
+		if (i > 0) m.ch(',');
+		m.num(shLatencyProbe.histogram(i));
+	}
+	m.key(F(";N:")).num(shLatencyProbe.count());
+	FlowSerialPrintLn(m);
+	FlowSerialPrintLn();
+	FlowSerialFlush();
+	shLatencyProbe.reset();
+}
+#endif
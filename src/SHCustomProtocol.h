@@ -2,41 +2,146 @@
 #define __SHCUSTOMPROTOCOL_H__
 
 #include <Arduino.h>
+#include <util/atomic.h>
+#include "SHClutchCombine.h"
+#include "SHDualClutchSensor.h"
+
+// Longest custom protocol line kept (BP/MODE/RA-FB/SHP/CRV/LB is ~150 characters);
+// the rest of a longer line is consumed and dropped.
+#define SH_PROTOCOL_LINE_MAX 192
 
 class SHCustomProtocol
 {
 private:
 	void (*clutchUpdateCallback)(uint16_t) = nullptr;
 	void (*calibrationCallback)(uint16_t, uint16_t, uint16_t, uint16_t) = nullptr;
+	void (*curveCallback)(const uint16_t*) = nullptr;
+	void (*brightnessCallback)(uint8_t) = nullptr;
+	uint8_t ledBrightness = 100;
 
-	// Extract the integer value after a key like "RA:" up to the next ';' or end of string.
-	static uint16_t extractUInt(const String &s, int start)
+	// Decimal digits at s (up to the next ';' or end of line); 0 when there are none.
+	static uint16_t extractUInt(const char* s)
 	{
-		int end = s.indexOf(';', start);
-		String token = (end > 0) ? s.substring(start, end) : s.substring(start);
-		return (uint16_t)token.toInt();
+		uint16_t value = 0;
+		while (*s >= '0' && *s <= '9')
+			value = value * 10 + (*s++ - '0');
+		return value;
 	}
 
-	double clutchBitePoint = 50.0;
+	// Parse a decimal like "14.5" or "14" after a key into tenths (145), rounding on the
+	// second decimal. Returns 0xFFFF when there are no digits or the value exceeds 100.0.
+	static uint16_t extractTenths(const char* s)
+	{
+		uint16_t value = 0;
+		uint8_t decimals = 0;
+		bool seenDot = false;
+		bool any = false;
+		bool roundUp = false;
+		for (; *s; s++)
+		{
+			char c = *s;
+			if (c == '.' && !seenDot)
+			{
+				seenDot = true;
+				continue;
+			}
+			if (c < '0' || c > '9')
+				break;
+			any = true;
+			if (!seenDot)
+			{
+				value = value * 10 + (c - '0');
+				if (value > 100)
+					return 0xFFFF;
+			}
+			else if (decimals == 0)
+			{
+				value = value * 10 + (c - '0');
+				decimals = 1;
+			}
+			else if (decimals == 1)
+			{
+				roundUp = (c >= '5');
+				decimals = 2;
+			}
+		}
+		if (!any)
+			return 0xFFFF;
+		if (decimals == 0)
+			value *= 10;
+		if (roundUp)
+			value++;
+		return value > CLUTCH_BP_MAX ? 0xFFFF : value;
+	}
+
+	// Parse "k0,k1,…" after a key into exactly CLUTCH_CURVE_KNOTS values.
+	// Returns false on a missing, extra, non-numeric or above-1000 knot.
+	static bool extractCurve(const char* s, uint16_t knots[CLUTCH_CURVE_KNOTS])
+	{
+		uint8_t n = 0;
+		bool any = false;
+		uint16_t value = 0;
+		for (;; s++)
+		{
+			char c = *s ? *s : ';';
+			if (c >= '0' && c <= '9')
+			{
+				value = value * 10 + (c - '0');
+				if (value > CLUTCH_CURVE_PERMILLE)
+					return false;
+				any = true;
+				continue;
+			}
+			if (!any || n >= CLUTCH_CURVE_KNOTS)
+				return false;
+			knots[n++] = value;
+			value = 0;
+			any = false;
+			if (c != ',')
+				break;
+		}
+		return n == CLUTCH_CURVE_KNOTS;
+	}
+
+	static void sendRotary(uint8_t channel, uint16_t pos)
+	{
+		SHMessage m;
+		m.key(F("ROT")).num(channel).ch(':').num(pos);
+		FlowSerialDebugPrintLn(m);
+	}
+
+	uint16_t clutchBitePoint = 500;                          // tenths of a percent (0-1000)
+	uint32_t clutchBiteWeight = clutchBiteWeightQ16(500);    // Q16 weight of clutch B, derived from clutchBitePoint
 	bool clutchAdjustMode = false;
 	uint16_t clutchAValue = 0;
 	uint16_t clutchBValue = 0;
 	uint8_t simhubPositions[3] = {8, 9, 10};
-	uint16_t lastCalculatedPWM = 0; // Restored: stores last computed 10-bit PWM
+	bool simhubPositionsChanged = false; // set when SHP: carries new slots, cleared by takeSimHubPositionsUpdate()
+	uint16_t lastCalculatedPWM = 0; // Restored: stores last combined clutch value (CLUTCH_AXIS_BITS)
 	uint16_t rotaryPosition = 0;  // ROT1 switch position (1-12)
 	uint8_t  rotary2Position = 0; // ROT2 switch position (1-12)
 	uint8_t  rotary3Position = 0; // ROT3 switch position (1-12)
 	uint8_t  rotary4Position = 0; // ROT4 switch position (1-12)
 	bool rotaryPositionSent = false;
-	unsigned long lastTelemetryTime = 0;
-	const unsigned long TELEMETRY_INTERVAL = 100;
 
 	unsigned long _lastReadMs = 0;     // for reconnect detection in read()
-	unsigned long lastHeartbeatTime = 0; // for 5-second periodic ROT1 in idle()
 
 public:
+	// Scheduler periods (ms) for sendTelemetry() and sendHeartbeat()
+	static const uint16_t TELEMETRY_INTERVAL = 100;
+	static const uint16_t HEARTBEAT_INTERVAL = 5000;
+
 	const uint8_t* getSimHubPositions() const { return simhubPositions; }
 
+	// True once per SHP: change. SimHub repeats the token every protocol cycle, so the
+	// routing table is only rebuilt on an actual change and an X route table survives.
+	bool takeSimHubPositionsUpdate()
+	{
+		bool changed = simhubPositionsChanged;
+		simhubPositionsChanged = false;
+		return changed;
+	}
+
 	// Setters — called from main.cpp idle() on each position read
 	void setRotaryPosition(uint8_t pos)  { rotaryPosition  = pos; }
 	void setRotary2Position(uint8_t pos) { rotary2Position = pos; }
@@ -47,12 +152,27 @@ public:
 	// Does NOT stream continuously.
 	void sendRotaryPosition()
 	{
-		FlowSerialDebugPrintLn("ROT1:" + String(rotaryPosition));
+		sendRotary(1, rotaryPosition);
 		rotaryPositionSent = true;
 	}
-	void sendRotary2Position() { FlowSerialDebugPrintLn("ROT2:" + String(rotary2Position)); }
-	void sendRotary3Position() { FlowSerialDebugPrintLn("ROT3:" + String(rotary3Position)); }
-	void sendRotary4Position() { FlowSerialDebugPrintLn("ROT4:" + String(rotary4Position)); }
+	void sendRotary2Position() { sendRotary(2, rotary2Position); }
+	void sendRotary3Position() { sendRotary(3, rotary3Position); }
+	void sendRotary4Position() { sendRotary(4, rotary4Position); }
+
+	// Report the fields of an input snapshot that changed since the last acknowledged one
+	// (InputSnapshotBuffer::diff()). Rotary positions go out as ROTn:p.
+	void reportInputChanges(const InputSnapshot& snap, uint8_t changed)
+	{
+		setRotaryPosition(snap.rot1());
+		setRotary2Position(snap.rot2());
+		setRotary3Position(snap.rot3());
+		setRotary4Position(snap.rot4());
+
+		if (changed & SNAP_ROT1) sendRotaryPosition();
+		if (changed & SNAP_ROT2) sendRotary2Position();
+		if (changed & SNAP_ROT3) sendRotary3Position();
+		if (changed & SNAP_ROT4) sendRotary4Position();
+	}
 	/*
 	CUSTOM PROTOCOL CLASS - DUAL CLUTCH WITH BITE POINT
 	SEE https://github.com/SHWotever/SimHub/wiki/Custom-Arduino-hardware-support
@@ -86,7 +206,21 @@ public:
 		calibrationCallback = callback;
 	}
 
-	double getClutchBitePoint() { return clutchBitePoint; }
+	void setCurveCallback(void (*callback)(const uint16_t*))
+	{
+		curveCallback = callback;
+	}
+
+	void setBrightnessCallback(void (*callback)(uint8_t))
+	{
+		brightnessCallback = callback;
+	}
+
+	// Bite point in tenths of a percent (0-1000)
+	uint16_t getClutchBitePoint() { return clutchBitePoint; }
+
+	// Last combined clutch value (CLUTCH_AXIS_BITS). Input-plane tick context.
+	uint16_t getLastCombined() const { return lastCalculatedPWM; }
 
 	void setClutchValues(uint16_t a, uint16_t b)
 	{
@@ -97,25 +231,12 @@ public:
 	// Calculate combined PWM from dual clutch and bite point
 	// Formula: PWM = (clutchA × (100 - BP)/100) + (clutchB × BP/100)
 	// This means: clutchA provides the base, clutchB modulates based on BP
+	// When BP is low (10%), clutchB has minimal effect, clutchA dominates
+	// When BP is high (90%), clutchB has maximum effect
+	// Fixed-point, see SHClutchCombine.h. Runs in the input-plane tick.
 	uint16_t calculateCombinedPWM(uint16_t clutchA, uint16_t clutchB)
 	{
-		// Normalize clutch values from 0-1023 to 0-100 percent
-		double clutchAPercent = (clutchA / 1023.0) * 100.0;
-		double clutchBPercent = (clutchB / 1023.0) * 100.0;
-
-		// Combined PWM calculation with bite point weighting
-		// When BP is low (10%), clutchB has minimal effect, clutchA dominates
-		// When BP is high (90%), clutchB has maximum effect
-		double weightA = (100.0 - clutchBitePoint) / 100.0;
-		double weightB = clutchBitePoint / 100.0;
-
-		double combinedPercent = (clutchAPercent * weightA) + (clutchBPercent * weightB);
-
-		// Convert back to 10-bit PWM range (0-1023)
-		// But clamp to valid range
-		uint16_t pwmValue = (uint16_t)((combinedPercent / 100.0) * 1023.0);
-		pwmValue = constrain(pwmValue, 0, 1023);
-
+		uint16_t pwmValue = clutchCombineQ16(clutchA, clutchB, clutchBiteWeight);
 		lastCalculatedPWM = pwmValue;
 		return pwmValue;
 	}
@@ -131,6 +252,10 @@ public:
 	// Extended format (when SimHub custom protocol expression includes cal fields):
 	//   BP:14.5;MODE:0;RA:608;FA:950;RB:610;FB:940
 	// The RA/FA/RB/FB fields are optional and backward-compatible.
+	// Optional response curve, CLUTCH_CURVE_KNOTS knots in permille of travel:
+	//   CRV:0,62,125,…,1000
+	// Optional LED brightness in percent (night / ambient mode):
+	//   LB:40
 	void read()
 	{
 		// Send ROT1 immediately on first read() (_lastReadMs == 0) or after a 3s gap.
@@ -143,81 +268,117 @@ public:
 		{
 			// First read after boot or reconnect — send all rotary positions immediately.
 			// SimHub is guaranteed to be listening at this exact moment.
-			FlowSerialDebugPrintLn("ROT1:" + String(rotaryPosition));
-			FlowSerialDebugPrintLn("ROT2:" + String(rotary2Position));
-			FlowSerialDebugPrintLn("ROT3:" + String(rotary3Position));
-			FlowSerialDebugPrintLn("ROT4:" + String(rotary4Position));
+			sendRotary(1, rotaryPosition);
+			sendRotary(2, rotary2Position);
+			sendRotary(3, rotary3Position);
+			sendRotary(4, rotary4Position);
 		}
 		_lastReadMs = now;
 
-		// Read the entire message in one shot for clean token isolation.
-		String msg = FlowSerialReadStringUntil('\n');
+		// Read the entire message in one shot for clean token isolation, into a stack
+		// buffer (a String here grew by realloc one character at a time, every cycle).
+		char msg[SH_PROTOCOL_LINE_MAX];
+		FlowSerialReadStringUntil(msg, sizeof(msg), '\n', '\n');
 
 		// Handle explicit rotary request from host (e.g., plugin asks for current position)
-		if (msg.indexOf("REQROT") >= 0 || msg.indexOf("GETROT") >= 0 || msg.indexOf("REQ_ROT") >= 0)
+		if (strstr_P(msg, PSTR("REQROT")) || strstr_P(msg, PSTR("GETROT")) || strstr_P(msg, PSTR("REQ_ROT")))
 		{
-			String resp = "ROT1:" + String(rotaryPosition);
-			FlowSerialDebugPrintLn(resp);
+			sendRotary(1, rotaryPosition);
 			rotaryPositionSent = true;
 			// continue processing the message if it contains other tokens
 		}
 
 		// --- Bite Point ---
-		int bpIdx = msg.indexOf("BP:");
-		if (bpIdx >= 0)
+		const char* bpTok = strstr_P(msg, PSTR("BP:"));
+		if (bpTok)
 		{
-			int end = msg.indexOf(';', bpIdx);
-			String val = (end > 0) ? msg.substring(bpIdx + 3, end) : msg.substring(bpIdx + 3);
-			double d = val.toDouble();
-			if (d >= 0.0 && d <= 100.0)
-				clutchBitePoint = d;
+			uint16_t bp = extractTenths(bpTok + 3);
+			if (bp != 0xFFFF && bp != clutchBitePoint)
+			{
+				uint32_t weight = clutchBiteWeightQ16(bp);
+				ATOMIC_BLOCK(ATOMIC_RESTORESTATE) // read by calculateCombinedPWM() in the input-plane tick
+				{
+					clutchBitePoint = bp;
+					clutchBiteWeight = weight;
+				}
+			}
 		}
 
 		// --- Adjust Mode ---
-		int modeIdx = msg.indexOf("MODE:");
-		if (modeIdx >= 0)
-			clutchAdjustMode = (msg.charAt(modeIdx + 5) == '1');
+		const char* modeTok = strstr_P(msg, PSTR("MODE:"));
+		if (modeTok)
+			clutchAdjustMode = (modeTok[5] == '1');
 
 		// --- Optional runtime calibration (requires SimHub device custom protocol
 		//     expression to include RA/FA/RB/FB fields — see Architecture.md) ---
 		if (calibrationCallback != nullptr)
 		{
-			int raIdx = msg.indexOf("RA:");
-			int faIdx = msg.indexOf("FA:");
-			int rbIdx = msg.indexOf("RB:");
-			int fbIdx = msg.indexOf("FB:");
-			if (raIdx >= 0 && faIdx >= 0 && rbIdx >= 0 && fbIdx >= 0)
+			const char* raTok = strstr_P(msg, PSTR("RA:"));
+			const char* faTok = strstr_P(msg, PSTR("FA:"));
+			const char* rbTok = strstr_P(msg, PSTR("RB:"));
+			const char* fbTok = strstr_P(msg, PSTR("FB:"));
+			if (raTok && faTok && rbTok && fbTok)
 			{
 				calibrationCallback(
-						extractUInt(msg, raIdx + 3),
-						extractUInt(msg, faIdx + 3),
-						extractUInt(msg, rbIdx + 3),
-						extractUInt(msg, fbIdx + 3));
+						extractUInt(raTok + 3),
+						extractUInt(faTok + 3),
+						extractUInt(rbTok + 3),
+						extractUInt(fbTok + 3));
 			}
 		}
 
-		// --- Configurable SimHub rotary positions (SHP:p1,p2,p3) ---
-		int shpIdx = msg.indexOf("SHP:");
-		if (shpIdx >= 0)
+		// --- Optional clutch response curve (CRV:k0,…,k16). The callback applies and
+		//     persists it only when it differs from the active curve. ---
+		if (curveCallback != nullptr)
+		{
+			const char* crvTok = strstr_P(msg, PSTR("CRV:"));
+			uint16_t knots[CLUTCH_CURVE_KNOTS];
+			if (crvTok && extractCurve(crvTok + 4, knots))
+				curveCallback(knots);
+		}
+
+		// --- Optional LED brightness (LB:0-100). Resent every cycle; the callback only
+		//     fires on a change. ---
+		if (brightnessCallback != nullptr)
 		{
-			String raw = msg.substring(shpIdx + 4);
-			int c1 = raw.indexOf(',');
-			int c2 = (c1 >= 0) ? raw.indexOf(',', c1 + 1) : -1;
-			if (c1 > 0 && c2 > c1)
+			const char* lbTok = strstr_P(msg, PSTR("LB:"));
+			if (lbTok)
 			{
-				int end = raw.indexOf(';', c2 + 1);
-				uint8_t p1 = (uint8_t)raw.substring(0, c1).toInt();
-				uint8_t p2 = (uint8_t)raw.substring(c1 + 1, c2).toInt();
-				uint8_t p3 = (uint8_t)(end > 0 ? raw.substring(c2 + 1, end) : raw.substring(c2 + 1)).toInt();
-				if (p1 >= 1 && p1 <= 12 && p2 >= 1 && p2 <= 12 && p3 >= 1 && p3 <= 12
-				    && p1 != p2 && p1 != p3 && p2 != p3)
+				uint16_t lb = extractUInt(lbTok + 3);
+				if (lb <= 100 && lb != ledBrightness)
 				{
-					simhubPositions[0] = p1;
-					simhubPositions[1] = p2;
-					simhubPositions[2] = p3;
+					ledBrightness = lb;
+					brightnessCallback(lb);
 				}
 			}
 		}
+
+		// --- Configurable SimHub rotary positions (SHP:p1,p2,p3) ---
+		const char* shpTok = strstr_P(msg, PSTR("SHP:"));
+		if (shpTok)
+		{
+			const char* p = shpTok + 4;
+			uint16_t pos[3];
+			uint8_t n = 0;
+			while (n < 3)
+			{
+				pos[n++] = extractUInt(p);
+				while (*p >= '0' && *p <= '9')
+					p++;
+				if (n < 3 && *p++ != ',')
+					break;
+			}
+			uint16_t p1 = pos[0], p2 = pos[1], p3 = pos[2];
+			if (n == 3 && p1 >= 1 && p1 <= 12 && p2 >= 1 && p2 <= 12 && p3 >= 1 && p3 <= 12
+			    && p1 != p2 && p1 != p3 && p2 != p3
+			    && (p1 != simhubPositions[0] || p2 != simhubPositions[1] || p3 != simhubPositions[2]))
+			{
+				simhubPositionsChanged = true;
+				simhubPositions[0] = p1;
+				simhubPositions[1] = p2;
+				simhubPositions[2] = p3;
+			}
+		}
 	}
 
 	// Called once per arduino loop, timing can't be predicted,
@@ -227,33 +388,41 @@ public:
 	}
 
 	// Called once between each byte read on arduino,
-	// Streams A/B clutch values back to SimHub only when in clutch adjust mode
 	// THIS IS A CRITICAL PATH :
 	// AVOID ANY TIME CONSUMING ROUTINES !!!
 	// PREFER READ OR LOOP METHOS AS MUCH AS POSSIBLE
 	// AVOID ANY INTERRUPTS DISABLE (serial data would be lost!!!)
+	// Periodic sends run as scheduler tasks instead — see sendTelemetry() / sendHeartbeat().
 	void idle()
 	{
-		unsigned long now = millis();
+	}
 
-		// CLT telemetry — only when clutch adjust mode is active
-		if (clutchAdjustMode && (now - lastTelemetryTime >= TELEMETRY_INTERVAL))
+	// Telemetry task (TELEMETRY_INTERVAL): stream A/B clutch values back to SimHub,
+	// only while clutch adjust mode is active.
+	void sendTelemetry()
+	{
+		if (!clutchAdjustMode)
+			return;
+		uint16_t a, b;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) // written by setClutchValues() in the input-plane tick
 		{
-			lastTelemetryTime = now;
-			FlowSerialDebugPrintLn("CLT:A:" + String(clutchAValue) + ";B:" + String(clutchBValue));
+			a = clutchAValue;
+			b = clutchBValue;
 		}
+		SHMessage m;
+		m.key(F("CLT:A:")).num(a).key(F(";B:")).num(b);
+		FlowSerialDebugPrintLn(m);
+	}
 
-		// Heartbeat: resend all rotary positions every 5 seconds.
-		// Keeps the plugin's connection-alive timer fresh and delivers current
-		// positions in case the read()-triggered send was missed.
-		if (now - lastHeartbeatTime >= 5000)
-		{
-			lastHeartbeatTime = now;
-			FlowSerialDebugPrintLn("ROT1:" + String(rotaryPosition));
-			FlowSerialDebugPrintLn("ROT2:" + String(rotary2Position));
-			FlowSerialDebugPrintLn("ROT3:" + String(rotary3Position));
-			FlowSerialDebugPrintLn("ROT4:" + String(rotary4Position));
-		}
+	// Heartbeat task (HEARTBEAT_INTERVAL): resend all rotary positions.
+	// Keeps the plugin's connection-alive timer fresh and delivers current
+	// positions in case the read()-triggered send was missed.
+	void sendHeartbeat()
+	{
+		sendRotary(1, rotaryPosition);
+		sendRotary(2, rotary2Position);
+		sendRotary(3, rotary3Position);
+		sendRotary(4, rotary4Position);
 	}
 };
 
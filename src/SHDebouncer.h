@@ -20,8 +20,9 @@ public:
 	}
 
 	bool Debounce() {
-		if (millis() - lastPoll > debounceDelay) {
-			lastPoll = millis();
+		unsigned long now = millis();
+		if (now - lastPoll > debounceDelay) {
+			lastPoll = now;
 			return true;
 		}
 		return false;
@@ -1,11 +1,50 @@
 #pragma once
 #include <Arduino.h>
+#include <util/atomic.h>
+
+// Oversample-and-decimate: each clutch sample is the sum of 4^n back-to-back 10-bit
+// conversions shifted right by n (SHInputPlane), giving 10+n effective bits. SS49E noise
+// (a few counts) provides the dither the technique needs. n = 2 → 12-bit axis from 16
+// conversions per channel (~1.7 ms at the 104 µs conversion time).
+#define CLUTCH_OVERSAMPLE_BITS 2
+#define CLUTCH_AXIS_BITS       (10 + CLUTCH_OVERSAMPLE_BITS)
+#define CLUTCH_AXIS_MAX        ((1U << CLUTCH_AXIS_BITS) - 1)
+
+#if CLUTCH_OVERSAMPLE_BITS > 3
+#error "CLUTCH_OVERSAMPLE_BITS > 3 needs 256+ conversions per sample and overflows the 16-bit axis path"
+#endif
+
+// Fixed clutch sample period: A burst + B burst + one ladder conversion (see SHInputPlane.h).
+#define CLUTCH_ADC_CONVERSION_US 104  // 13 ADC clocks at clk/128 (125 kHz, within the 200 kHz limit)
+#define CLUTCH_BURST             (1 << (2 * CLUTCH_OVERSAMPLE_BITS))
+#define CLUTCH_SAMPLE_PERIOD_US  ((2 * CLUTCH_BURST + 1) * CLUTCH_ADC_CONVERSION_US)
+
+// On-device calibration capture (X clutchcal): endpoints closer than this (10-bit counts)
+// are rejected as "lever not swept".
+#define CLUTCH_CAL_MIN_SPAN       64
+#define CLUTCH_CAL_RECORD_VERSION 1
+
+// Where the active calibration came from
+#define CLUTCH_CAL_SOURCE_DEFAULT 0 // CLUTCH_x_CAL_* in hardwareSettings.h
+#define CLUTCH_CAL_SOURCE_EEPROM  1 // captured on device
+#define CLUTCH_CAL_SOURCE_HOST    2 // RA/FA/RB/FB from SimHub
+
+// Minimum change (axis units) that fires onClutchChange. 0 = every change; raise only if a
+// downstream consumer needs fewer updates — any gate here reappears as stair-stepping.
+#define CLUTCH_DEADBAND 0
+
+#include "SHClutchFilter.h"
+#include "SHClutchCurve.h"
 
 // Dual Clutch Hall Effect Sensor Reader on A4, A5
 // SS49E linear Hall sensors: output rests at Vcc/2 (~608 ADC on 5V supply).
-// Calibration maps [calRest, calFull] -> 0-1023 so the output starts at zero
+// Calibration maps [calRest, calFull] -> 0-CLUTCH_AXIS_MAX so the output starts at zero
 // when the lever is released. Works for both magnet orientations (calFull can
-// be higher or lower than calRest — map() handles reversed ranges).
+// be higher or lower than calRest). The division is done once in setCalibration(): per
+// sample it is a clamp and one Q16 multiply, then the shared response curve (SHClutchCurve.h).
+//
+// Calibration endpoints and everything reported to SimHub (CLT:, RA/FA/RB/FB) stay in
+// 10-bit units; toHostUnits() / the << CLUTCH_OVERSAMPLE_BITS in setCalibration() convert.
 class SHDualClutchSensor
 {
 private:
@@ -17,85 +56,254 @@ private:
   uint16_t lastClutchAValue = 0xFFFF;
   uint16_t lastClutchBValue = 0xFFFF;
 
-  unsigned long lastReadTime = 0;
-  const unsigned long READ_INTERVAL = 10; // Read every 10ms
+  // Per-channel filter stage (SHClutchFilter.h), applied before calibration
+  SHClutchFilter filterA;
+  SHClutchFilter filterB;
+  uint16_t lastRawA = 0;
+  uint16_t lastRawB = 0;
+  uint16_t filteredA = 0;
+  uint16_t filteredB = 0;
 
-  // Simple moving average filter
-  static const int FILTER_SIZE = 4;
-  uint16_t clutchAFilter[FILTER_SIZE] = {0};
-  uint16_t clutchBFilter[FILTER_SIZE] = {0};
-  int filterIndex = 0;
+  // Per-channel calibration, precomputed from the endpoints (axis units, host value << CLUTCH_OVERSAMPLE_BITS).
+  // rest = raw ADC when lever is fully RELEASED (no magnet influence).
+  // full = raw ADC when lever is fully PRESSED, rest ± span.
+  // Default 0/max = passthrough (no remapping) until real values are measured.
+  struct Calibration
+  {
+    uint16_t rest;
+    uint16_t span;      // |full - rest|, 0xFFFF with scale 0 for a degenerate rest == full
+    uint32_t scaleQ16;  // CLUTCH_AXIS_MAX / span in Q16
+    bool reversed;      // full < rest (magnet pushes the reading down)
+  };
+  Calibration calA;
+  Calibration calB;
+  uint16_t activeCal[4] = {0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF}; // restA, fullA, restB, fullB (10-bit)
+  uint16_t lastHostCal[4] = {0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF}; // last RA/FA/RB/FB seen, 0xFFFF = none yet
+  uint8_t calSource = CLUTCH_CAL_SOURCE_DEFAULT;
 
-  // Per-channel calibration endpoints.
-  // calRest  = raw ADC when lever is fully RELEASED (no magnet influence).
-  // calFull  = raw ADC when lever is fully PRESSED.
-  // Default 0/1023 = passthrough (no remapping) until real values are measured.
-  uint16_t calRestA = 0;
-  uint16_t calFullA = 1023;
-  uint16_t calRestB = 0;
-  uint16_t calFullB = 1023;
+  // Capture mode: per-channel filtered extremes (axis units) while the driver sweeps the paddles
+  volatile bool capturing = false;
+  uint16_t capMin[2];
+  uint16_t capMax[2];
+  uint16_t capStart[2];
+  bool capStarted = false;
 
-  // Map raw ADC to 0-1023 using the calibrated endpoints.
-  // constrain clamps values outside the measured travel range.
-  uint16_t applyCalibration(uint16_t raw, uint16_t calRest, uint16_t calFull)
+  SHClutchCurve curve;
+
+  void trackCapture()
   {
-    if (calRest == calFull)
-      return 0; // safety: avoid degenerate mapping
-    long mapped = map((long)raw, (long)calRest, (long)calFull, 0L, 1023L);
-    return (uint16_t)constrain(mapped, 0, 1023);
+    uint16_t v[2] = {filteredA, filteredB};
+    for (uint8_t ch = 0; ch < 2; ch++)
+    {
+      if (!capStarted)
+        capStart[ch] = capMin[ch] = capMax[ch] = v[ch];
+      else if (v[ch] < capMin[ch])
+        capMin[ch] = v[ch];
+      else if (v[ch] > capMax[ch])
+        capMax[ch] = v[ch];
+    }
+    capStarted = true;
+  }
+
+  static Calibration makeCalibration(uint16_t rest, uint16_t full)
+  {
+    Calibration c;
+    c.rest = rest;
+    c.reversed = full < rest;
+    c.span = c.reversed ? rest - full : full - rest;
+    if (c.span == 0)
+    {
+      c.span = 0xFFFF; // safety: degenerate mapping reads as released
+      c.scaleQ16 = 0;
+    }
+    else
+      c.scaleQ16 = (((uint32_t)CLUTCH_AXIS_MAX << 16) + c.span / 2) / c.span;
+    return c;
+  }
+
+  // Map raw axis value to 0-CLUTCH_AXIS_MAX using the calibrated endpoints, clamping
+  // values outside the measured travel. d < span keeps d × scale below 2^28.
+  static uint16_t applyCalibration(uint16_t raw, const Calibration& c)
+  {
+    uint16_t d;
+    if (c.reversed)
+      d = raw >= c.rest ? 0 : c.rest - raw;
+    else
+      d = raw <= c.rest ? 0 : raw - c.rest;
+    if (d >= c.span)
+      return CLUTCH_AXIS_MAX;
+    return (uint16_t)(((uint32_t)d * c.scaleQ16) >> 16);
   }
 
 public:
-  // Set calibration at runtime (called from protocol callback or setup).
+  // Convert an axis value (CLUTCH_AXIS_BITS) to the 10-bit units SimHub uses.
+  static uint16_t toHostUnits(uint16_t axis) { return axis >> CLUTCH_OVERSAMPLE_BITS; }
+
+  // The original map() + constrain() calibration, kept only as the X clutchbench reference.
+  static uint16_t applyCalibrationReference(uint16_t raw, uint16_t calRest, uint16_t calFull)
+  {
+    if (calRest == calFull)
+      return 0;
+    long mapped = map((long)raw, (long)calRest, (long)calFull, 0L, (long)CLUTCH_AXIS_MAX);
+    return (uint16_t)constrain(mapped, 0L, (long)CLUTCH_AXIS_MAX);
+  }
+
+  // Set calibration at runtime (setup defaults, host values, device capture).
+  // Endpoints are 10-bit raw ADC values; the scales are only recomputed on a change.
+  // Atomic: update() runs in the input-plane tick.
   void setCalibration(uint16_t restA, uint16_t fullA, uint16_t restB, uint16_t fullB)
   {
-    calRestA = restA;
-    calFullA = fullA;
-    calRestB = restB;
-    calFullB = fullB;
+    if (restA == activeCal[0] && fullA == activeCal[1] && restB == activeCal[2] && fullB == activeCal[3])
+      return;
+    activeCal[0] = restA;
+    activeCal[1] = fullA;
+    activeCal[2] = restB;
+    activeCal[3] = fullB;
+
+    Calibration a = makeCalibration(restA << CLUTCH_OVERSAMPLE_BITS, fullA << CLUTCH_OVERSAMPLE_BITS);
+    Calibration b = makeCalibration(restB << CLUTCH_OVERSAMPLE_BITS, fullB << CLUTCH_OVERSAMPLE_BITS);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      calA = a;
+      calB = b;
+    }
   }
 
-  void begin()
+  // Restore a calibration captured on device. Returns false (nothing applied) when the
+  // EEPROM record is blank or corrupt — setup() then applies the CLUTCH_x_CAL_* defaults.
+  bool loadCalibration()
   {
-    pinMode(CLUTCH_A_PIN, INPUT);
-    pinMode(CLUTCH_B_PIN, INPUT);
-    // Default cal = 0/1023 passthrough. main.cpp setup() calls setCalibration()
-    // with the CLUTCH_x_CAL_REST/FULL constants from hardwareSettings.h.
+    uint16_t cal[4];
+    if (!SHEepromStore::load(EEPROM_ADDR_CLUTCH_CAL, CLUTCH_CAL_RECORD_VERSION, cal, sizeof(cal)))
+      return false;
+    setCalibration(cal[0], cal[1], cal[2], cal[3]);
+    calSource = CLUTCH_CAL_SOURCE_EEPROM;
+    return true;
   }
 
-  // Read both clutch sensors with filtering and debouncing
-  void read(void (*onClutchChange)(uint16_t, uint16_t) = nullptr)
+  // RA/FA/RB/FB from SimHub, repeated every protocol cycle. Applied when the host values
+  // change — except the first set after boot when a device-captured calibration is active:
+  // that is the plugin replaying its stored values, and the captured endpoints win until
+  // the driver actually edits them in the plugin.
+  void setHostCalibration(uint16_t restA, uint16_t fullA, uint16_t restB, uint16_t fullB)
   {
-    // Rate limit reads
-    if (millis() - lastReadTime < READ_INTERVAL)
+    if (restA == lastHostCal[0] && fullA == lastHostCal[1] && restB == lastHostCal[2] && fullB == lastHostCal[3])
       return;
+    bool first = lastHostCal[0] == 0xFFFF;
+    lastHostCal[0] = restA;
+    lastHostCal[1] = fullA;
+    lastHostCal[2] = restB;
+    lastHostCal[3] = fullB;
+    if (first && calSource == CLUTCH_CAL_SOURCE_EEPROM)
+      return;
+    setCalibration(restA, fullA, restB, fullB);
+    calSource = CLUTCH_CAL_SOURCE_HOST;
+  }
 
-    lastReadTime = millis();
+  // Start capturing: hold both paddles released, then sweep each fully. The first sample
+  // after start marks the released side of each channel.
+  void beginCapture()
+  {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      capStarted = false;
+      capturing = true;
+    }
+  }
 
-    // Read raw analog values (0-1023)
-    uint16_t rawA = analogRead(CLUTCH_A_PIN);
-    uint16_t rawB = analogRead(CLUTCH_B_PIN);
+  void abortCapture() { capturing = false; }
+  bool isCapturing() const { return capturing; }
 
-    // Apply moving average filter
-    clutchAFilter[filterIndex] = rawA;
-    clutchBFilter[filterIndex] = rawB;
-    filterIndex = (filterIndex + 1) % FILTER_SIZE;
+  // Finish capturing: the extreme farther from the start sample becomes FULL, the opposite
+  // extreme REST (so the output reads exactly 0 across the released noise band).
+  // Applied and saved to EEPROM with CRC. Returns false — and keeps capturing — when a
+  // channel moved less than CLUTCH_CAL_MIN_SPAN.
+  bool commitCapture()
+  {
+    uint16_t lo[2], hi[2], start[2];
+    bool started;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      started = capStarted;
+      for (uint8_t ch = 0; ch < 2; ch++)
+      {
+        lo[ch] = toHostUnits(capMin[ch]);
+        hi[ch] = toHostUnits(capMax[ch]);
+        start[ch] = toHostUnits(capStart[ch]);
+      }
+    }
+    if (!capturing || !started)
+      return false;
 
-    // Calculate filtered average
-    uint32_t sumA = 0, sumB = 0;
-    for (int i = 0; i < FILTER_SIZE; i++)
+    uint16_t cal[4];
+    for (uint8_t ch = 0; ch < 2; ch++)
     {
-      sumA += clutchAFilter[i];
-      sumB += clutchBFilter[i];
+      if (hi[ch] - lo[ch] < CLUTCH_CAL_MIN_SPAN)
+        return false;
+      bool pressedUp = hi[ch] - start[ch] > start[ch] - lo[ch];
+      cal[ch * 2] = pressedUp ? lo[ch] : hi[ch];
+      cal[ch * 2 + 1] = pressedUp ? hi[ch] : lo[ch];
     }
+    capturing = false;
+    setCalibration(cal[0], cal[1], cal[2], cal[3]);
+    calSource = CLUTCH_CAL_SOURCE_EEPROM;
+    SHEepromStore::save(EEPROM_ADDR_CLUTCH_CAL, CLUTCH_CAL_RECORD_VERSION, cal, sizeof(cal));
+    return true;
+  }
 
-    // Apply per-channel calibration: raw ADC -> 0-1023 useful range.
-    clutchAValue = applyCalibration(sumA / FILTER_SIZE, calRestA, calFullA);
-    clutchBValue = applyCalibration(sumB / FILTER_SIZE, calRestB, calFullB);
+  // Active endpoints (10-bit: restA, fullA, restB, fullB) and where they came from.
+  const uint16_t* getCalibration() const { return activeCal; }
+  uint8_t getCalibrationSource() const { return calSource; }
 
-    // Check if values changed significantly (more than 5 units post-calibration)
-    if (abs((int)clutchAValue - (int)lastClutchAValue) >= 5 ||
-        abs((int)clutchBValue - (int)lastClutchBValue) >= 5)
+  // Current capture extremes of one channel, 10-bit (0 / 0 before the first sample).
+  void getCapture(uint8_t channel, uint16_t& lo, uint16_t& hi)
+  {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      lo = capStarted ? toHostUnits(capMin[channel]) : 0;
+      hi = capStarted ? toHostUnits(capMax[channel]) : 0;
+    }
+  }
+
+  // Shared response curve applied after calibration (both channels).
+  SHClutchCurve& getCurve() { return curve; }
+
+  // Calibrate and shape one filtered sample of channel 0 (A) or 1 (B).
+  uint16_t calibrate(uint8_t channel, uint16_t raw) const
+  {
+    return curve.evaluate(applyCalibration(raw, channel == 0 ? calA : calB));
+  }
+
+  void begin()
+  {
+    pinMode(CLUTCH_A_PIN, INPUT);
+    pinMode(CLUTCH_B_PIN, INPUT);
+    filterA.configure(CLUTCH_FILTER_DEFAULT, CLUTCH_FILTER_DEFAULT_P1, CLUTCH_FILTER_DEFAULT_P2, 0, CLUTCH_SAMPLE_PERIOD_US);
+    filterB.configure(CLUTCH_FILTER_DEFAULT, CLUTCH_FILTER_DEFAULT_P1, CLUTCH_FILTER_DEFAULT_P2, 0, CLUTCH_SAMPLE_PERIOD_US);
+    calA = calB = makeCalibration(0, CLUTCH_AXIS_MAX);
+    curve.begin();
+    // Default cal = 0/1023 passthrough. main.cpp setup() restores a device-captured
+    // calibration (loadCalibration) or applies the CLUTCH_x_CAL_REST/FULL constants.
+  }
+
+  // Filter and calibrate one A/B sample pair (oversampled, 0-CLUTCH_AXIS_MAX).
+  // Called from the input-plane tick each time a fresh pair is decimated (every CLUTCH_SAMPLE_PERIOD_US, ~3.4 ms).
+  void update(uint16_t rawA, uint16_t rawB, void (*onClutchChange)(uint16_t, uint16_t) = nullptr)
+  {
+    lastRawA = rawA;
+    lastRawB = rawB;
+
+    // Apply per-channel calibration to the filtered value (raw axis -> 0-CLUTCH_AXIS_MAX
+    // useful range), then the response curve.
+    filteredA = filterA.update(rawA);
+    filteredB = filterB.update(rawB);
+    if (capturing)
+      trackCapture();
+    clutchAValue = calibrate(0, filteredA);
+    clutchBValue = calibrate(1, filteredB);
+
+    if (abs((int)clutchAValue - (int)lastClutchAValue) > CLUTCH_DEADBAND ||
+        abs((int)clutchBValue - (int)lastClutchBValue) > CLUTCH_DEADBAND)
     {
       lastClutchAValue = clutchAValue;
       lastClutchBValue = clutchBValue;
@@ -107,13 +315,58 @@ public:
     }
   }
 
-  // Get current clutch values
-  uint16_t getClutchA() { return clutchAValue; }
-  uint16_t getClutchB() { return clutchBValue; }
+  // Select the filter of one channel (0 = A, 1 = B) at runtime, seeded with the channel's
+  // last raw sample so the output doesn't jump. Returns false for invalid parameters.
+  bool setFilter(uint8_t channel, uint8_t type, uint8_t p1, uint8_t p2)
+  {
+    bool ok;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      if (channel == 0)
+        ok = filterA.configure(type, p1, p2, lastRawA, CLUTCH_SAMPLE_PERIOD_US);
+      else
+        ok = filterB.configure(type, p1, p2, lastRawB, CLUTCH_SAMPLE_PERIOD_US);
+    }
+    return ok;
+  }
+
+  // Filter of channel 0 (A) or 1 (B), for its configuration and measured profile.
+  // Fields are 8/16-bit and updated in the tick — read them with interrupts masked if exactness matters.
+  const SHClutchFilter& getFilter(uint8_t channel) const { return channel == 0 ? filterA : filterB; }
+
+  // Pipeline stages of the last sample, for the clutch stream (SHClutchStream.h).
+  // Tick context only — no locking.
+  static const uint8_t STAGE_RAW = 0;
+  static const uint8_t STAGE_FILTERED = 1;
+  static const uint8_t STAGE_CALIBRATED = 2;
+  uint16_t stageValue(uint8_t stage, uint8_t channel) const
+  {
+    if (stage == STAGE_RAW)
+      return channel == 0 ? lastRawA : lastRawB;
+    if (stage == STAGE_FILTERED)
+      return channel == 0 ? filteredA : filteredB;
+    return channel == 0 ? clutchAValue : clutchBValue;
+  }
+
+  // Get current clutch values (axis units)
+  uint16_t getClutchA()
+  {
+    uint16_t v;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { v = clutchAValue; }
+    return v;
+  }
+  uint16_t getClutchB()
+  {
+    uint16_t v;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { v = clutchBValue; }
+    return v;
+  }
 
   // For debugging
   void printValues()
   {
-    FlowSerialDebugPrintLn("Clutch A: " + String(clutchAValue) + " | Clutch B: " + String(clutchBValue));
+    SHMessage m;
+    m.key(F("Clutch A: ")).num(getClutchA()).key(F(" | Clutch B: ")).num(getClutchB());
+    FlowSerialDebugPrintLn(m);
   }
 };
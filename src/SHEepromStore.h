@@ -0,0 +1,93 @@
+#ifndef __SHEEPROMSTORE_H__
+#define __SHEEPROMSTORE_H__
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "ArqSerial.h" // crc_table_crc8 / updateCrc
+
+// EEPROM address map. Every record is stored as <payload><crc8>; the CRC is the same
+// CRC-8 the ARQ link uses, seeded with the record version so a layout change (or a
+// blank 0xFF chip) reads back as invalid and the caller falls back to its defaults.
+#define EEPROM_ADDR_LADDER       0   // 4 rotary ladders × (24 + 1 + 1) bytes = 104 bytes
+#define EEPROM_ADDR_CLUTCH_CURVE 104 // 17 or 33 knots × 2 + 1 bytes (≤ 67 bytes)
+#define EEPROM_ADDR_CLUTCH_CAL   171 // 4 endpoints × 2 + 1 bytes
+#define EEPROM_ADDR_LED_FX       180 // LED effect layout, 20 + 1 bytes
+
+// Background saves (saveStep) from scheduler tasks. Those run from idle(), which ARQ also
+// calls inside its serial reads, so a save may start while the host is streaming: the
+// 64-byte RX ring fills in ~33 ms at 19200 baud, and a whole record (up to ~35 cells at
+// 3.3 ms) would overrun it. A step writes at most EEPROM_SAVE_STEP_CELLS cells (~10 ms) and
+// only starts once the link has been quiet for EEPROM_SAVE_QUIET_MS (see SHLedCommit.h).
+#define EEPROM_SAVE_STEP_CELLS   3
+#define EEPROM_SAVE_QUIET_MS     20
+
+class SHEepromStore
+{
+public:
+	static uint8_t crc(uint8_t version, const uint8_t* data, uint8_t len)
+	{
+		uint8_t currentCrc = 0;
+		currentCrc = updateCrc(currentCrc, version);
+		for (uint8_t i = 0; i < len; i++) {
+			currentCrc = updateCrc(currentCrc, data[i]);
+		}
+		return currentCrc;
+	}
+
+	// Returns false (dst contents undefined) when the stored CRC does not match.
+	static bool load(int addr, uint8_t version, void* dst, uint8_t len)
+	{
+		uint8_t* p = (uint8_t*)dst;
+		for (uint8_t i = 0; i < len; i++) {
+			p[i] = EEPROM.read(addr + i);
+		}
+		return EEPROM.read(addr + len) == crc(version, p, len);
+	}
+
+	// EEPROM.update() skips unchanged bytes, so re-saving a mostly unchanged record
+	// costs one 3.3 ms cell write per byte that actually moved.
+	static void save(int addr, uint8_t version, const void* src, uint8_t len)
+	{
+		const uint8_t* p = (const uint8_t*)src;
+		for (uint8_t i = 0; i < len; i++) {
+			EEPROM.update(addr + i, p[i]);
+		}
+		EEPROM.update(addr + len, crc(version, p, len));
+	}
+
+	// save() in bounded steps for background callers. pos is the caller's cursor, 0 at the
+	// start of a pass; unchanged cells are skipped without counting. Returns true once the
+	// CRC is written (pos back at 0). The CRC covers src as it is at the end of the pass, so
+	// a caller whose data changed mid-pass must run another pass; a reset in between leaves
+	// a CRC mismatch and the record falls back to defaults, as with a torn save().
+	static bool saveStep(int addr, uint8_t version, const void* src, uint8_t len, uint8_t& pos)
+	{
+		const uint8_t* p = (const uint8_t*)src;
+		uint8_t cells = 0;
+		for (; pos < len; pos++) {
+			if (EEPROM.read(addr + pos) == p[pos])
+				continue;
+			if (cells == EEPROM_SAVE_STEP_CELLS)
+				return false;
+			EEPROM.write(addr + pos, p[pos]);
+			cells++;
+		}
+		uint8_t c = crc(version, p, len);
+		if (EEPROM.read(addr + len) != c) {
+			if (cells == EEPROM_SAVE_STEP_CELLS)
+				return false;
+			EEPROM.write(addr + len, c);
+		}
+		pos = 0;
+		return true;
+	}
+
+	// True when no host byte is pending and none arrived for EEPROM_SAVE_QUIET_MS
+	// (lastRx in millis(), ArqSerial::lastRx()).
+	static bool linkQuiet(unsigned long now, unsigned long lastRx)
+	{
+		return Serial.available() == 0 && now - lastRx >= EEPROM_SAVE_QUIET_MS;
+	}
+};
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef __SHINPUTPLANE_H__
+#define __SHINPUTPLANE_H__
+
+#include <Arduino.h>
+#include <util/atomic.h>
+#include "RingBuffer.h"
+#include "SHDualClutchSensor.h"
+#include "SHLatencyProbe.h"
+
+// Hard-real-time input plane: a 1 kHz Timer2 tick that runs independently of serial traffic.
+//
+// The ADC runs as a background stream owned by this class: ADC_vect collects each result
+// and immediately starts the next conversion (clk/128 → 104 µs each, ~9.6k/s). One cycle is
+//   clutch A burst (4^CLUTCH_OVERSAMPLE_BITS conversions) → clutch B burst → one ladder
+// conversion (A0-A3 in turn), about 3.4 ms at the default 16 conversions per burst. Each
+// burst is summed and decimated (>> CLUTCH_OVERSAMPLE_BITS) into a CLUTCH_AXIS_BITS sample.
+//
+// The 1 kHz tick runs the time-critical input work:
+//   - clutch sample → PWM as soon as a fresh decimated A/B pair is in (onClutchSample);
+//   - encoder drain, SR pulse expiry and SR commit (onTick).
+// Everything that talks to SimHub stays in the main loop: button events produced inside the
+// tick are queued here and drained by a scheduler task. Ladder decoding reads the cached
+// conversions through copyLadderAdc().
+//
+// Timer2 CTC, prescaler 64, OCR2A 249 → 16 MHz / 64 / 250 = 1 kHz. The vector is declared
+// ISR_NOBLOCK in main.cpp so USART RX stays serviced during a tick; a tick that fires while
+// the previous one is still running is skipped and counted. ADC_vect is a plain (short) ISR.
+
+#define INPUT_PLANE_OCR2A         249
+#define INPUT_PLANE_LADDERS       4   // A0-A3
+#define INPUT_PLANE_CLUTCH_A      4   // ADC mux channel of A4
+#define INPUT_PLANE_CLUTCH_B      5   // ADC mux channel of A5
+#define INPUT_PLANE_CLUTCH_BURST  CLUTCH_BURST
+// clk/128 → 125 kHz ADC clock. The datasheet gives full 10-bit accuracy only up to 200 kHz,
+// and oversampling to 12 bits only holds if the 10-bit conversions are linear; clk/64
+// (250 kHz) would halve the sample period at the cost of that guarantee.
+#define INPUT_PLANE_ADC_PRESCALER ((1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0))
+#define INPUT_PLANE_EVENT_QUEUE   16
+#define INPUT_PLANE_EVENT_PRESSED 0x80 // queued event byte: bit 7 = state, bits 0-6 = button id - 100
+
+// ADC stream stage
+#define INPUT_PLANE_STAGE_CLUTCH_A 0
+#define INPUT_PLANE_STAGE_CLUTCH_B 1
+#define INPUT_PLANE_STAGE_LADDER   2
+
+class SHInputPlane
+{
+private:
+	void (*_onClutchSample)(uint16_t rawA, uint16_t rawB) = nullptr;
+	void (*_onTick)(unsigned long now) = nullptr;
+
+	// ADC stream state (ADC_vect)
+	uint8_t _stage = INPUT_PLANE_STAGE_CLUTCH_A;
+	uint8_t _ladderChannel = 0;
+	uint8_t _burstLeft = 0;
+	uint16_t _acc = 0;          // ≤ 64 × 1023, fits for CLUTCH_OVERSAMPLE_BITS ≤ 3
+	uint16_t _pendingA = 0;
+
+	// Published results
+	uint16_t _ladderAdc[INPUT_PLANE_LADDERS] = {};
+	uint16_t _clutchA = 0;      // CLUTCH_AXIS_BITS
+	uint16_t _clutchB = 0;
+	volatile bool _clutchReady = false;
+#if CLUTCH_LATENCY_PROBE
+	uint16_t _clutchReadyUs = 0; // micros() when the pair was decimated
+	uint16_t _clutchPickedUs = 0;
+#endif
+
+	RingBuffer<uint8_t, INPUT_PLANE_EVENT_QUEUE> _events;
+
+	volatile bool _busy = false;
+	uint16_t _skipped = 0;      // ticks dropped because the previous tick was still running
+	uint16_t _dropped = 0;      // button events lost to a full queue
+	uint16_t _maxTickUs = 0;
+
+	// Start the first conversion of the current stage.
+	void startStage()
+	{
+		uint8_t channel;
+		if (_stage == INPUT_PLANE_STAGE_CLUTCH_A)
+			channel = INPUT_PLANE_CLUTCH_A;
+		else if (_stage == INPUT_PLANE_STAGE_CLUTCH_B)
+			channel = INPUT_PLANE_CLUTCH_B;
+		else
+			channel = _ladderChannel;
+		_burstLeft = (_stage == INPUT_PLANE_STAGE_LADDER) ? 1 : INPUT_PLANE_CLUTCH_BURST;
+		_acc = 0;
+		ADMUX = (1 << REFS0) | channel; // AVcc reference, same as analogRead(DEFAULT)
+		ADCSRA |= (1 << ADSC);
+	}
+
+public:
+	// Prime the ADC cache with blocking reads (so the first ladder decode and clutch sample are
+	// valid) and start the 1 kHz tick. Call last in setup(), once all consumers are initialised.
+	void begin(void (*onClutchSample)(uint16_t, uint16_t), void (*onTick)(unsigned long))
+	{
+		_onClutchSample = onClutchSample;
+		_onTick = onTick;
+
+		for (uint8_t ch = 0; ch < INPUT_PLANE_LADDERS; ch++)
+			_ladderAdc[ch] = analogRead(A0 + ch);
+		_clutchA = analogRead(A0 + INPUT_PLANE_CLUTCH_A) << CLUTCH_OVERSAMPLE_BITS;
+		_clutchB = analogRead(A0 + INPUT_PLANE_CLUTCH_B) << CLUTCH_OVERSAMPLE_BITS;
+
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			// ADC stream: interrupt per conversion, each one started from ADC_vect
+			ADCSRA = (1 << ADEN) | (1 << ADIE) | INPUT_PLANE_ADC_PRESCALER;
+			_stage = INPUT_PLANE_STAGE_CLUTCH_A;
+			startStage();
+
+			TCCR2A = (1 << WGM21); // CTC, TOP = OCR2A
+			TCCR2B = (1 << CS22);  // clk/64
+			OCR2A = INPUT_PLANE_OCR2A;
+			TCNT2 = 0;
+			TIMSK2 |= (1 << OCIE2A);
+		}
+	}
+
+	// ADC_vect body: accumulate, advance the burst/stage, start the next conversion.
+	void adcComplete()
+	{
+		_acc += ADC;
+		if (--_burstLeft)
+		{
+			ADCSRA |= (1 << ADSC);
+			return;
+		}
+
+		if (_stage == INPUT_PLANE_STAGE_CLUTCH_A)
+		{
+			_pendingA = _acc >> CLUTCH_OVERSAMPLE_BITS;
+			_stage = INPUT_PLANE_STAGE_CLUTCH_B;
+		}
+		else if (_stage == INPUT_PLANE_STAGE_CLUTCH_B)
+		{
+			_clutchA = _pendingA;
+			_clutchB = _acc >> CLUTCH_OVERSAMPLE_BITS;
+			_clutchReady = true;
+#if CLUTCH_LATENCY_PROBE
+			_clutchReadyUs = (uint16_t)micros();
+#endif
+			_stage = INPUT_PLANE_STAGE_LADDER;
+		}
+		else
+		{
+			_ladderAdc[_ladderChannel] = _acc;
+			_ladderChannel = (_ladderChannel + 1) & (INPUT_PLANE_LADDERS - 1);
+			_stage = INPUT_PLANE_STAGE_CLUTCH_A;
+		}
+		startStage();
+	}
+
+	// Timer2 compare-match body. Runs with interrupts enabled.
+	void tick()
+	{
+		if (_busy)
+		{
+			_skipped++;
+			return;
+		}
+		_busy = true;
+		unsigned long start = micros();
+
+		if (_clutchReady && _onClutchSample)
+		{
+			uint16_t a, b;
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+			{
+				a = _clutchA;
+				b = _clutchB;
+				_clutchReady = false;
+#if CLUTCH_LATENCY_PROBE
+				_clutchPickedUs = _clutchReadyUs;
+#endif
+			}
+			_onClutchSample(a, b);
+		}
+
+		if (_onTick)
+			_onTick(millis());
+
+		unsigned long elapsed = micros() - start;
+		if (elapsed > _maxTickUs)
+			_maxTickUs = elapsed > 0xFFFF ? 0xFFFF : (uint16_t)elapsed;
+		_busy = false;
+	}
+
+#if CLUTCH_LATENCY_PROBE
+	// ADC completion time of the pair being handed to onClutchSample (low 16 bits of micros()).
+	uint16_t clutchSampleUs() const { return _clutchPickedUs; }
+#endif
+
+	// Latest conversions of the four ladder channels (A0-A3), 10-bit.
+	void copyLadderAdc(uint16_t dst[INPUT_PLANE_LADDERS])
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			for (uint8_t ch = 0; ch < INPUT_PLANE_LADDERS; ch++)
+				dst[ch] = _ladderAdc[ch];
+		}
+	}
+
+	// Tick side: queue a SimHub button event (id ≥ 100) for the main loop.
+	void pushButtonEvent(int buttonId, byte state)
+	{
+		uint8_t ev = (uint8_t)(buttonId - 100) | (state ? INPUT_PLANE_EVENT_PRESSED : 0);
+		if (!_events.lockedPush(ev))
+			_dropped++;
+	}
+
+	// Main-loop side: pop one queued event. Returns false when the queue is empty.
+	bool popButtonEvent(int& buttonId, byte& state)
+	{
+		uint8_t ev;
+		if (!_events.lockedPop(ev))
+			return false;
+		buttonId = 100 + (ev & ~INPUT_PLANE_EVENT_PRESSED);
+		state = (ev & INPUT_PLANE_EVENT_PRESSED) ? 1 : 0;
+		return true;
+	}
+
+	uint16_t maxTickUs()
+	{
+		uint16_t v;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { v = _maxTickUs; }
+		return v;
+	}
+	uint16_t skippedTicks()
+	{
+		uint16_t v;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { v = _skipped; }
+		return v;
+	}
+	uint16_t droppedEvents()
+	{
+		uint16_t v;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { v = _dropped; }
+		return v;
+	}
+	void resetStats()
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			_maxTickUs = 0;
+			_skipped = 0;
+			_dropped = 0;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef __SHLATENCYPROBE_H__
+#define __SHLATENCYPROBE_H__
+
+#include <Arduino.h>
+#include <util/atomic.h>
+
+// Sample-to-PWM latency instrumentation for the clutch path (build option, off by default:
+// add -D CLUTCH_LATENCY_PROBE=1 to build_flags in platformio.ini).
+//
+// A sample is stamped with micros() (Timer0, 4 µs resolution) at each stage:
+//   ADC     B burst decimated in ADC_vect (SHInputPlane)
+//   PICKUP  input-plane tick picks the pair up
+//   FILTER  filtered + calibrated, onClutchSensorsChanged() entered
+//   COMBINE calculateCombinedPWM() done
+//   PWM     OCR1A written
+// Each segment and the ADC → PWM total keep min/avg/max; the total also feeds a histogram.
+// Samples the change gate drops never reach PWM and are not counted. X clutchlat reports.
+//
+// Cost when enabled: five micros() calls (~3.5 µs each) per sample in the tick.
+
+#ifndef CLUTCH_LATENCY_PROBE
+#define CLUTCH_LATENCY_PROBE 0
+#endif
+
+#define LATENCY_STAGE_ADC     0
+#define LATENCY_STAGE_PICKUP  1
+#define LATENCY_STAGE_FILTER  2
+#define LATENCY_STAGE_COMBINE 3
+#define LATENCY_STAGE_PWM     4
+#define LATENCY_STAGES        5
+
+#define LATENCY_SEGMENTS      LATENCY_STAGES // 4 stage-to-stage segments + the total
+#define LATENCY_TOTAL         (LATENCY_STAGES - 1)
+#define LATENCY_HIST_BINS     16
+#define LATENCY_HIST_SHIFT    7              // 128 µs bins, last bin open-ended (≥ 1.92 ms)
+
+#if CLUTCH_LATENCY_PROBE
+#define CLUTCH_LATENCY_MARK(stage) shLatencyProbe.mark(stage)
+#define CLUTCH_LATENCY_START(us)   shLatencyProbe.start(us)
+#else
+#define CLUTCH_LATENCY_MARK(stage)
+#define CLUTCH_LATENCY_START(us)
+#endif
+
+class SHLatencyProbe
+{
+private:
+	struct Segment
+	{
+		uint16_t min;
+		uint16_t max;
+		uint32_t sum;
+	};
+
+	uint16_t _stamp[LATENCY_STAGES];
+	Segment _seg[LATENCY_SEGMENTS];
+	uint16_t _count;
+	uint16_t _hist[LATENCY_HIST_BINS];
+
+public:
+	SHLatencyProbe() { reset(); }
+
+	// Begin a sample at the given ADC completion time (low 16 bits of micros()).
+	void start(uint16_t adcUs)
+	{
+		_stamp[LATENCY_STAGE_ADC] = adcUs;
+	}
+
+	// Stamp a stage; the PWM stage closes the sample and folds it into the statistics.
+	// Called from the input-plane tick only.
+	void mark(uint8_t stage)
+	{
+		_stamp[stage] = (uint16_t)micros();
+		if (stage != LATENCY_STAGE_PWM || _count == 0xFFFF)
+			return;
+
+		for (uint8_t i = 0; i < LATENCY_SEGMENTS; i++)
+		{
+			uint16_t us = (i == LATENCY_TOTAL)
+				? _stamp[LATENCY_STAGE_PWM] - _stamp[LATENCY_STAGE_ADC]
+				: _stamp[i + 1] - _stamp[i];
+			Segment& s = _seg[i];
+			if (us < s.min) s.min = us;
+			if (us > s.max) s.max = us;
+			s.sum += us;
+		}
+		uint16_t total = _stamp[LATENCY_STAGE_PWM] - _stamp[LATENCY_STAGE_ADC];
+		uint16_t bin = total >> LATENCY_HIST_SHIFT;
+		_hist[bin < LATENCY_HIST_BINS ? bin : LATENCY_HIST_BINS - 1]++;
+		_count++;
+	}
+
+	// Copy out one segment (0-3 stage to stage, LATENCY_TOTAL = ADC → PWM), atomically.
+	void segment(uint8_t i, uint16_t& minUs, uint16_t& avgUs, uint16_t& maxUs)
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			minUs = _count ? _seg[i].min : 0;
+			maxUs = _seg[i].max;
+			avgUs = _count ? (uint16_t)(_seg[i].sum / _count) : 0;
+		}
+	}
+
+	uint16_t count()
+	{
+		uint16_t v;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { v = _count; }
+		return v;
+	}
+
+	uint16_t histogram(uint8_t bin)
+	{
+		uint16_t v;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { v = _hist[bin]; }
+		return v;
+	}
+
+	void reset()
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			for (uint8_t i = 0; i < LATENCY_SEGMENTS; i++)
+			{
+				_seg[i].min = 0xFFFF;
+				_seg[i].max = 0;
+				_seg[i].sum = 0;
+			}
+			for (uint8_t i = 0; i < LATENCY_HIST_BINS; i++)
+				_hist[i] = 0;
+			_count = 0;
+		}
+	}
+};
+
+#endif
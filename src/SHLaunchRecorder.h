@@ -0,0 +1,209 @@
+#ifndef __SHLAUNCHRECORDER_H__
+#define __SHLAUNCHRECORDER_H__
+
+#include <Arduino.h>
+#include <util/atomic.h>
+#include "SHDualClutchSensor.h"
+#include "SHClutchCombine.h"
+
+// Launch flight recorder: captures the ~2 s around a paddle release and measures it on device.
+//
+// Runs in the input-plane tick on every clutch sample (CLUTCH_SAMPLE_PERIOD_US). The recorder
+// arms once the combined clutch is above trigger + LAUNCH_ARM_HYSTERESIS and triggers when it
+// falls through the trigger level. From the trigger it measures at full sample rate:
+//   REL    trigger → first entry into the bite zone (bite point ± band)
+//   DWELL  total time spent inside the bite zone
+//   OVS    deepest dip below the zone that came back into it (a release that overshot the
+//          bite point and was caught), in permille of travel
+//   FULL   trigger → combined below LAUNCH_FULL_RELEASE_PCT (clutch fully out)
+// A decimated trace of A, B and combined (8 bits each, one entry per LAUNCH_TRACE_DECIMATION
+// samples ≈ 31 ms) keeps LAUNCH_TRACE_PRE entries before the trigger and the rest after it
+// (~0.5 s + 1.5 s). Once the trace is complete the recorder holds until X launch re-arms it.
+
+#define LAUNCH_TRACE_ENTRIES    64
+#define LAUNCH_TRACE_PRE        16
+#define LAUNCH_TRACE_DECIMATION 9      // × 3.432 ms ≈ 31 ms per entry
+#define LAUNCH_TRACE_SHIFT      (CLUTCH_AXIS_BITS - 8)
+#define LAUNCH_ARM_HYSTERESIS   5      // % of travel above the trigger level needed to arm
+#define LAUNCH_FULL_RELEASE_PCT 3
+#define LAUNCH_DEFAULT_TRIGGER  90     // % of travel
+#define LAUNCH_DEFAULT_BAND     5      // ± % of travel around the bite point
+
+#define LAUNCH_IDLE      0
+#define LAUNCH_ARMED     1
+#define LAUNCH_RECORDING 2
+#define LAUNCH_DONE      3
+
+#define LAUNCH_NOT_REACHED 0xFFFF
+
+class SHLaunchRecorder
+{
+private:
+	uint8_t _trace[LAUNCH_TRACE_ENTRIES][3];
+	uint8_t _head = 0;          // next trace slot
+	uint8_t _filled = 0;        // entries written, saturating at LAUNCH_TRACE_ENTRIES
+	uint8_t _decimation = 1;
+	uint8_t _postLeft = 0;      // trace entries still to record after the trigger
+
+	volatile uint8_t _state = LAUNCH_IDLE;
+	uint8_t _triggerPct = LAUNCH_DEFAULT_TRIGGER;
+	uint8_t _bandPct = LAUNCH_DEFAULT_BAND;
+	uint16_t _armLevel = 0;     // axis units, derived from the percentages in configure()
+	uint16_t _triggerLevel = 0;
+	uint16_t _fullLevel = 0;
+	uint16_t _band = 0;
+
+	// Metrics, in samples since the trigger
+	uint16_t _bpTenths = 0;     // bite point at the trigger
+	uint16_t _target = 0;
+	uint16_t _samples = 0;
+	uint16_t _release = LAUNCH_NOT_REACHED;
+	uint16_t _dwell = 0;
+	uint16_t _full = LAUNCH_NOT_REACHED;
+	uint16_t _dip = 0;
+	uint16_t _overshoot = 0;
+
+	static uint16_t percentOfTravel(uint8_t pct)
+	{
+		return (uint16_t)(((uint32_t)CLUTCH_AXIS_MAX * pct) / 100);
+	}
+
+	void record(uint16_t a, uint16_t b, uint16_t combined)
+	{
+		if (--_decimation)
+			return;
+		_decimation = LAUNCH_TRACE_DECIMATION;
+		uint8_t* e = _trace[_head];
+		e[0] = a >> LAUNCH_TRACE_SHIFT;
+		e[1] = b >> LAUNCH_TRACE_SHIFT;
+		e[2] = combined >> LAUNCH_TRACE_SHIFT;
+		_head = (_head + 1) % LAUNCH_TRACE_ENTRIES;
+		if (_filled < LAUNCH_TRACE_ENTRIES)
+			_filled++;
+		if (_state == LAUNCH_RECORDING && --_postLeft == 0)
+			_state = LAUNCH_DONE;
+	}
+
+	void measure(uint16_t combined)
+	{
+		if (_samples < 0xFFFE)
+			_samples++;
+		bool inZone = combined + _band >= _target && combined <= _target + _band;
+		if (inZone)
+		{
+			if (_release == LAUNCH_NOT_REACHED)
+				_release = _samples;
+			if (_dwell < 0xFFFE)
+				_dwell++;
+			if (_dip > _overshoot)
+				_overshoot = _dip;
+			_dip = 0;
+		}
+		else if (_release != LAUNCH_NOT_REACHED && combined + _band < _target)
+		{
+			uint16_t dip = _target - _band - combined;
+			if (dip > _dip)
+				_dip = dip;
+		}
+		if (_full == LAUNCH_NOT_REACHED && combined <= _fullLevel)
+			_full = _samples;
+	}
+
+public:
+	SHLaunchRecorder() { configure(LAUNCH_DEFAULT_TRIGGER, LAUNCH_DEFAULT_BAND); }
+
+	// Trigger level and bite-zone half-width in % of travel. Re-arms the recorder.
+	bool configure(uint8_t triggerPct, uint8_t bandPct)
+	{
+		if (triggerPct < LAUNCH_FULL_RELEASE_PCT + 1 || triggerPct + LAUNCH_ARM_HYSTERESIS > 100 || bandPct == 0 || bandPct > 25)
+			return false;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			_triggerPct = triggerPct;
+			_bandPct = bandPct;
+			_triggerLevel = percentOfTravel(triggerPct);
+			_armLevel = percentOfTravel(triggerPct + LAUNCH_ARM_HYSTERESIS);
+			_fullLevel = percentOfTravel(LAUNCH_FULL_RELEASE_PCT);
+			_band = percentOfTravel(bandPct);
+			_state = LAUNCH_IDLE;
+		}
+		return true;
+	}
+
+	// Tick side: one calibrated A/B sample and its combined value (axis units).
+	// bpTenths is only read at the trigger.
+	void capture(uint16_t a, uint16_t b, uint16_t combined, uint16_t bpTenths)
+	{
+		uint8_t state = _state;
+		if (state == LAUNCH_DONE)
+			return;
+
+		if (state == LAUNCH_IDLE && combined >= _armLevel)
+			_state = LAUNCH_ARMED;
+		else if (state == LAUNCH_ARMED && combined < _triggerLevel)
+		{
+			_bpTenths = bpTenths;
+			_target = (uint16_t)(((uint32_t)CLUTCH_AXIS_MAX * bpTenths) / CLUTCH_BP_MAX);
+			_samples = 0;
+			_release = LAUNCH_NOT_REACHED;
+			_dwell = 0;
+			_full = LAUNCH_NOT_REACHED;
+			_dip = 0;
+			_overshoot = 0;
+			_postLeft = LAUNCH_TRACE_ENTRIES - LAUNCH_TRACE_PRE;
+			_state = LAUNCH_RECORDING;
+		}
+		if (_state == LAUNCH_RECORDING)
+			measure(combined);
+		record(a, b, combined);
+	}
+
+	uint8_t state() const { return _state; }
+	uint8_t triggerPct() const { return _triggerPct; }
+	uint8_t bandPct() const { return _bandPct; }
+
+	// Main-loop side. Metrics are stable once state() is LAUNCH_DONE; while recording they
+	// are a snapshot taken with interrupts off.
+	void metrics(uint16_t& bpTenths, uint16_t& release, uint16_t& dwell, uint16_t& overshootPermille, uint16_t& full)
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			bpTenths = _bpTenths;
+			release = _release;
+			dwell = _dwell;
+			overshootPermille = (uint16_t)(((uint32_t)_overshoot * 1000) / CLUTCH_AXIS_MAX);
+			full = _full;
+		}
+	}
+
+	// Samples → ms at the fixed clutch sample period; LAUNCH_NOT_REACHED passes through.
+	static uint16_t toMs(uint16_t samples)
+	{
+		if (samples == LAUNCH_NOT_REACHED)
+			return samples;
+		return (uint16_t)(((uint32_t)samples * CLUTCH_SAMPLE_PERIOD_US + 500) / 1000);
+	}
+
+	// Trace of a completed launch, oldest first: count() entries, the trigger at index
+	// count() - (LAUNCH_TRACE_ENTRIES - LAUNCH_TRACE_PRE). Only valid in LAUNCH_DONE.
+	uint8_t count() const { return _filled; }
+	const uint8_t* entry(uint8_t i) const
+	{
+		uint8_t oldest = (_head + LAUNCH_TRACE_ENTRIES - _filled) % LAUNCH_TRACE_ENTRIES;
+		return _trace[(oldest + i) % LAUNCH_TRACE_ENTRIES];
+	}
+
+	// Back to idle for the next launch; the trace restarts from empty.
+	void rearm()
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			_filled = 0;
+			_head = 0;
+			_decimation = 1;
+			_state = LAUNCH_IDLE;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef __SHLEDCOMMIT_H__
+#define __SHLEDCOMMIT_H__
+
+#include <Arduino.h>
+
+// LED commit scheduling: decides when strip data received by read() is shown.
+//
+// FastLED drives the WS2812B with interrupts off (FASTLED_ALLOW_INTERRUPTS 0), about 30 µs
+// per LED — ~750 µs for 25 LEDs. The UART holds 2 bytes in hardware, so any byte that
+// arrives while the show runs is lost once more than ~2 byte times pass:
+//   19200 baud → 1.04 ms, 115200 → 174 µs, 1 Mbaud → 20 µs.
+// The only window where the host is guaranteed silent is inside the LED command, after the
+// last pixel byte and before its 0x15 ack: the host waits for the ack before it sends
+// anything else. commit() runs the show there, provided the RX ring is empty (nothing
+// unexpected in flight); otherwise the show is deferred and service() (scheduler task)
+// runs it once the link has been quiet for LED_COMMIT_QUIET_MS. A deferred frame is also
+// superseded by the next LED command, which commits in its own safe slot.
+//
+// service() is reached through idle(), which also runs inside the LED command's own
+// serial reads. A link that goes quiet mid-frame (NAck and resend) would then show a
+// half-received frame, so the caller skips service() while the strip's read() is in
+// progress (SHRGBLedsBase::ingesting()).
+//
+// Presents are also paced to LED_PRESENT_HZ: a safe slot that comes sooner than one frame
+// interval after the previous present leaves the frame pending (back buffer, see
+// SHRGBLedsNeoPixelFastLed.h) for a later slot. Bursts of LED commands then cannot stack
+// shows back to back, and interrupts-off time is capped at LED_PRESENT_HZ shows per second
+// (~45 ms/s for 25 LEDs at 60 Hz).
+
+#define LED_COMMIT_QUIET_MS     20
+#define LED_PRESENT_HZ          60
+#define LED_PRESENT_INTERVAL_MS (1000 / LED_PRESENT_HZ)
+
+typedef void (*SHLedShowFunction)();
+
+class SHLedCommit
+{
+private:
+	bool _pending = false;
+	uint16_t _shows = 0;      // commits in the safe slot
+	uint16_t _deferred = 0;   // safe slot skipped because bytes were in flight
+	uint16_t _quiet = 0;      // deferred commits run by service()
+	uint16_t _unchanged = 0;  // frames identical to the strip, no show needed
+	uint16_t _paced = 0;      // safe slots held back by LED_PRESENT_HZ
+	uint16_t _maxShowUs = 0;
+	uint32_t _showUs = 0;     // total show time, interrupts off
+	unsigned long _lastPresent = 0;
+
+	bool due(unsigned long now) const
+	{
+		return now - _lastPresent >= LED_PRESENT_INTERVAL_MS;
+	}
+
+	void run(SHLedShowFunction show, unsigned long now)
+	{
+		unsigned long start = micros();
+		show();
+		unsigned long us = micros() - start;
+		if (us > _maxShowUs)
+			_maxShowUs = us > 0xFFFF ? 0xFFFF : (uint16_t)us;
+		_showUs += us;
+		_lastPresent = now;
+		_pending = false;
+	}
+
+public:
+	// Safe slot: called by the LED command once its data is read, before the ack.
+	bool commit(SHLedShowFunction show)
+	{
+		if (Serial.available() > 0)
+		{
+			_pending = true;
+			if (_deferred < 0xFFFF)
+				_deferred++;
+			return false;
+		}
+		unsigned long now = millis();
+		if (!due(now))
+		{
+			_pending = true;
+			if (_paced < 0xFFFF)
+				_paced++;
+			return false;
+		}
+		run(show, now);
+		if (_shows < 0xFFFF)
+			_shows++;
+		return true;
+	}
+
+	// A show is wanted outside a command (local rendering); service() runs it.
+	void request()
+	{
+		_pending = true;
+	}
+
+	// Frame left every LED as it was.
+	void unchanged()
+	{
+		if (_unchanged < 0xFFFF)
+			_unchanged++;
+	}
+
+	// Scheduler side: runs a deferred show once nothing has been received for
+	// LED_COMMIT_QUIET_MS (lastRx in millis()).
+	void service(SHLedShowFunction show, unsigned long now, unsigned long lastRx)
+	{
+		if (!_pending || !due(now) || Serial.available() > 0 || now - lastRx < LED_COMMIT_QUIET_MS)
+			return;
+		run(show, now);
+		if (_quiet < 0xFFFF)
+			_quiet++;
+	}
+
+	bool pending() const { return _pending; }
+	uint16_t shows() const { return _shows; }
+	uint16_t deferred() const { return _deferred; }
+	uint16_t quietShows() const { return _quiet; }
+	uint16_t unchangedFrames() const { return _unchanged; }
+	uint16_t pacedSlots() const { return _paced; }
+	uint32_t showUs() const { return _showUs; }
+	uint16_t maxShowUs() const { return _maxShowUs; }
+
+	void resetStats()
+	{
+		_shows = 0;
+		_deferred = 0;
+		_quiet = 0;
+		_unchanged = 0;
+		_paced = 0;
+		_maxShowUs = 0;
+		_showUs = 0;
+	}
+};
+
+#endif
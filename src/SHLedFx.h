@@ -0,0 +1,220 @@
+#ifndef __SHLEDFX_H__
+#define __SHLEDFX_H__
+
+#include <Arduino.h>
+#include "SHEepromStore.h"
+
+// On-device shift-light and flag effects rendered from a 3-byte telemetry packet.
+//
+// A full mode 1 LED frame is ~76 bytes on the link; X ledfx <rpm %><flags><status> is 3
+// bytes of payload. The Nano renders three segments of the strip (host LED order):
+//   bar   fills from rpmStart % to rpmShift % in three colour zones; at or above rpmShift
+//         the whole bar blinks in the last zone colour. Pit limiter overrides it with the
+//         two bar halves alternating in the limiter colour.
+//   flag  one colour for the highest-priority flag (red > yellow > blue > green > white);
+//         blue blinks, the others are solid.
+//   drs   green when DRS is open, blinking green when it is available.
+// Segments with a count of 0 are skipped; LEDs outside the segments are left alone.
+//
+// Layout and colours are set once with X ledfxcfg and persisted (EEPROM_ADDR_LED_FX).
+// The scheduler re-renders at LED_FX_FRAME_MS so blinks keep running between packets;
+// the strip's dirty tracking turns unchanged renders into no-ops. Telemetry older than
+// LED_FX_TIMEOUT_MS deactivates the engine and leaves the strip to the '6' command.
+
+#define LED_FX_FRAME_MS        20
+#define LED_FX_TIMEOUT_MS      1000
+#define LED_FX_SHIFT_BLINK_MS  60
+#define LED_FX_LIMITER_MS      250
+#define LED_FX_SLOW_BLINK_MS   500
+#define LED_FX_RECORD_VERSION  1
+
+// Telemetry flags byte
+#define LED_FX_FLAG_YELLOW     0x01
+#define LED_FX_FLAG_BLUE       0x02
+#define LED_FX_FLAG_RED        0x04
+#define LED_FX_FLAG_GREEN      0x08
+#define LED_FX_FLAG_WHITE      0x10
+
+// Telemetry status byte
+#define LED_FX_STATUS_LIMITER  0x01
+#define LED_FX_STATUS_DRS_AVAIL 0x02
+#define LED_FX_STATUS_DRS_OPEN 0x04
+
+typedef void (*SHLedFxPixelFunction)(uint8_t led, uint8_t r, uint8_t g, uint8_t b);
+
+class SHLedFx
+{
+public:
+	// X ledfxcfg payload, byte for byte (20 bytes)
+	struct Config
+	{
+		uint8_t barFirst, barCount;
+		uint8_t rpmStart, rpmShift;    // %
+		uint8_t flagFirst, flagCount;
+		uint8_t drsFirst, drsCount;
+		uint8_t zone[3][3];            // bar colours, low / mid / high third (RGB)
+		uint8_t limiter[3];
+	};
+
+private:
+	Config _cfg;
+	uint8_t _leds = 0;
+	bool _stored = false;
+	bool _active = false;
+	unsigned long _lastTelemetry = 0;
+	uint8_t _rpm = 0;
+	uint8_t _flags = 0;
+	uint8_t _status = 0;
+
+	void loadDefaults()
+	{
+		// 15-LED rev bar, 5 flag LEDs, 5 DRS LEDs: the RB19 layout at 25 LEDs
+		static const Config defaults PROGMEM = {
+			0, 15, 60, 95, 15, 5, 20, 5,
+			{ { 0, 255, 0 }, { 255, 0, 0 }, { 128, 0, 255 } },
+			{ 0, 0, 255 }
+		};
+		memcpy_P(&_cfg, &defaults, sizeof(_cfg));
+	}
+
+	bool fits(uint8_t first, uint8_t count) const
+	{
+		return count == 0 || (uint16_t)first + count <= _leds;
+	}
+
+	bool valid(const Config& c) const
+	{
+		return fits(c.barFirst, c.barCount) && fits(c.flagFirst, c.flagCount) && fits(c.drsFirst, c.drsCount)
+			&& c.rpmStart < c.rpmShift && c.rpmShift <= 100;
+	}
+
+	static bool phase(unsigned long now, uint16_t periodMs)
+	{
+		return (now / periodMs) & 1;
+	}
+
+	static void fill(SHLedFxPixelFunction px, uint8_t first, uint8_t count, const uint8_t* rgb)
+	{
+		for (uint8_t i = 0; i < count; i++)
+			px(first + i, rgb[0], rgb[1], rgb[2]);
+	}
+
+	void renderBar(unsigned long now, SHLedFxPixelFunction px)
+	{
+		static const uint8_t off[3] = { 0, 0, 0 };
+		uint8_t n = _cfg.barCount;
+		if (_status & LED_FX_STATUS_LIMITER)
+		{
+			uint8_t half = n / 2;
+			bool p = phase(now, LED_FX_LIMITER_MS);
+			fill(px, _cfg.barFirst, half, p ? _cfg.limiter : off);
+			fill(px, _cfg.barFirst + half, n - half, p ? off : _cfg.limiter);
+			return;
+		}
+		if (_rpm >= _cfg.rpmShift)
+		{
+			fill(px, _cfg.barFirst, n, phase(now, LED_FX_SHIFT_BLINK_MS) ? off : _cfg.zone[2]);
+			return;
+		}
+		// LEDs lit, rounded to nearest, linear between rpmStart and rpmShift
+		uint8_t lit = 0;
+		if (_rpm > _cfg.rpmStart)
+			lit = (uint8_t)(((uint16_t)(_rpm - _cfg.rpmStart) * n * 2 + (_cfg.rpmShift - _cfg.rpmStart)) / (2 * (_cfg.rpmShift - _cfg.rpmStart)));
+		for (uint8_t i = 0; i < n; i++)
+		{
+			const uint8_t* c = i >= lit ? off : _cfg.zone[(uint16_t)i * 3 / n];
+			px(_cfg.barFirst + i, c[0], c[1], c[2]);
+		}
+	}
+
+	void renderFlag(unsigned long now, SHLedFxPixelFunction px)
+	{
+		static const uint8_t colours[5][3] PROGMEM = {
+			{ 255, 0, 0 },     // red
+			{ 255, 200, 0 },   // yellow
+			{ 0, 0, 255 },     // blue
+			{ 0, 255, 0 },     // green
+			{ 255, 255, 255 }  // white
+		};
+		static const uint8_t order[5] = { LED_FX_FLAG_RED, LED_FX_FLAG_YELLOW, LED_FX_FLAG_BLUE, LED_FX_FLAG_GREEN, LED_FX_FLAG_WHITE };
+		uint8_t rgb[3] = { 0, 0, 0 };
+		for (uint8_t i = 0; i < 5; i++)
+		{
+			if (_flags & order[i])
+			{
+				if (order[i] != LED_FX_FLAG_BLUE || !phase(now, LED_FX_SLOW_BLINK_MS))
+					memcpy_P(rgb, colours[i], 3);
+				break;
+			}
+		}
+		fill(px, _cfg.flagFirst, _cfg.flagCount, rgb);
+	}
+
+	void renderDrs(unsigned long now, SHLedFxPixelFunction px)
+	{
+		bool on = (_status & LED_FX_STATUS_DRS_OPEN)
+			|| ((_status & LED_FX_STATUS_DRS_AVAIL) && !phase(now, LED_FX_SLOW_BLINK_MS));
+		const uint8_t rgb[3] = { 0, (uint8_t)(on ? 255 : 0), 0 };
+		fill(px, _cfg.drsFirst, _cfg.drsCount, rgb);
+	}
+
+public:
+	// Restore the persisted layout, or the defaults (clipped to the strip).
+	void begin(uint8_t leds)
+	{
+		_leds = leds;
+		_stored = SHEepromStore::load(EEPROM_ADDR_LED_FX, LED_FX_RECORD_VERSION, &_cfg, sizeof(_cfg)) && valid(_cfg);
+		if (!_stored)
+		{
+			loadDefaults();
+			if (!fits(_cfg.barFirst, _cfg.barCount))
+				_cfg.barCount = _leds;
+			if (!fits(_cfg.flagFirst, _cfg.flagCount))
+				_cfg.flagCount = 0;
+			if (!fits(_cfg.drsFirst, _cfg.drsCount))
+				_cfg.drsCount = 0;
+		}
+	}
+
+	// Apply and persist a new layout (X ledfxcfg). False when a segment leaves the strip
+	// or the rpm thresholds are out of order.
+	bool configure(const Config& c)
+	{
+		if (!valid(c))
+			return false;
+		_cfg = c;
+		SHEepromStore::save(EEPROM_ADDR_LED_FX, LED_FX_RECORD_VERSION, &_cfg, sizeof(_cfg));
+		_stored = true;
+		return true;
+	}
+
+	void telemetry(uint8_t rpmPct, uint8_t flags, uint8_t status, unsigned long now)
+	{
+		_rpm = rpmPct;
+		_flags = flags;
+		_status = status;
+		_lastTelemetry = now;
+		_active = true;
+	}
+
+	// True while telemetry is fresh; goes false (once) after LED_FX_TIMEOUT_MS.
+	bool active(unsigned long now)
+	{
+		if (_active && now - _lastTelemetry > LED_FX_TIMEOUT_MS)
+			_active = false;
+		return _active;
+	}
+
+	// Write every segment LED through px. Cheap to repeat: unchanged LEDs stay clean.
+	void render(unsigned long now, SHLedFxPixelFunction px)
+	{
+		renderBar(now, px);
+		renderFlag(now, px);
+		renderDrs(now, px);
+	}
+
+	const Config& config() const { return _cfg; }
+	bool isStored() const { return _stored; }
+};
+
+#endif
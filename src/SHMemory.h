@@ -0,0 +1,112 @@
+#ifndef __SHMEMORY_H__
+#define __SHMEMORY_H__
+
+#include <Arduino.h>
+
+// RAM high-water marks for the 2 KB of SRAM (X mem).
+//
+// Layout, low to high: .data + .bss (static), heap (grows up from __heap_start to
+// __brkval), free gap, stack (grows down from RAMEND). A collision is silent corruption,
+// so the margin has to be measured, not guessed.
+//
+//   stack  shMemoryPaint() runs in .init3, before constructors and main(), and fills
+//          everything from the end of .bss to RAMEND with SHMEMORY_PAINT. The lowest
+//          byte the stack ever touched is the first non-paint byte above the heap.
+//          Stack frames that leave locals unwritten can hide a few bytes, so treat the
+//          figure as a close lower bound of the real depth.
+//   heap   __brkval only moves when malloc() extends the heap and drops back when the
+//          top block is freed, so sample() (called from idle()) keeps the peak.
+//          The free list (__flp) shows fragmentation: freed blocks below __brkval that
+//          only a request of their size or smaller can reuse.
+
+#define SHMEMORY_PAINT 0xC5
+
+extern "C" {
+	extern uint8_t __data_start;
+	extern uint8_t __bss_end;
+	extern uint8_t __heap_start;
+	extern char* __brkval;
+	struct __freelist
+	{
+		size_t sz;
+		struct __freelist* nx;
+	};
+	extern struct __freelist* __flp;
+}
+
+// Runs from the startup code: no prologue, no stack frame, nothing on the stack yet
+// (SP = RAMEND). The volatile store keeps GCC from turning the loop into a memset()
+// call, whose return address would sit in the range being painted.
+void shMemoryPaint() __attribute__((naked, used, section(".init3")));
+void shMemoryPaint()
+{
+	for (volatile uint8_t* p = &__heap_start; p < (uint8_t*)SP; p++)
+		*p = SHMEMORY_PAINT;
+}
+
+class SHMemory
+{
+private:
+	uint16_t _heapMax = 0;
+
+	static uint8_t* heapTop()
+	{
+		return __brkval ? (uint8_t*)__brkval : &__heap_start;
+	}
+
+public:
+	struct FreeList
+	{
+		uint8_t blocks;
+		uint16_t bytes;
+		uint16_t largest;
+	};
+
+	// Cheap enough for every idle() pass: one pointer read and a compare.
+	void sample()
+	{
+		uint16_t heap = heapTop() - &__heap_start;
+		if (heap > _heapMax)
+			_heapMax = heap;
+	}
+
+	static uint16_t staticBytes() { return &__bss_end - &__data_start; }
+	static uint16_t heapBytes() { return heapTop() - &__heap_start; }
+	uint16_t heapMax() const { return _heapMax; }
+
+	// Current stack depth and gap between heap top and stack pointer.
+	static uint16_t stackBytes() { return RAMEND - SP; }
+	static uint16_t freeBytes() { return (uint8_t*)SP - heapTop(); }
+
+	// Lowest address the stack has reached since boot: scan up from the heap peak to the
+	// first touched byte.
+	uint8_t* stackLow() const
+	{
+		uint8_t* p = &__heap_start + _heapMax;
+		uint8_t* sp = (uint8_t*)SP;
+		while (p < sp && *p == SHMEMORY_PAINT)
+			p++;
+		return p;
+	}
+
+	uint16_t stackMax() const { return (uint8_t*)RAMEND - stackLow(); }
+
+	// Bytes between the heap peak and the stack peak that were never touched.
+	uint16_t untouched() const { return stackLow() - (&__heap_start + _heapMax); }
+
+	static FreeList freeList()
+	{
+		FreeList fl = { 0, 0, 0 };
+		for (struct __freelist* b = __flp; b; b = b->nx)
+		{
+			if (fl.blocks < 0xFF)
+				fl.blocks++;
+			fl.bytes += b->sz;
+			if (b->sz > fl.largest)
+				fl.largest = b->sz;
+		}
+		return fl;
+	}
+};
+
+#endif
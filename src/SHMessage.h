@@ -0,0 +1,141 @@
+#ifndef __SHMESSAGE_H__
+#define __SHMESSAGE_H__
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+// Fixed-buffer outbound message formatter, a heap-free replacement for String concatenation.
+//
+// A message lives on the caller's stack, keys come from flash (F("CLT:A:")), and numbers
+// are converted by subtracting powers of ten (no division — AVR has no divide instruction,
+// and utoa()/String(n) go through a ~200-cycle software divide per digit). The finished
+// buffer is sent as one ARQ frame by FlowSerialPrintLn() / FlowSerialDebugPrintLn().
+// Text past the capacity is dropped rather than overflowing.
+//
+//   SHMessage m;
+//   m.key(F("CLT:A:")).num(a).key(F(";B:")).num(b);
+//   FlowSerialDebugPrintLn(m);
+//
+// SHLongMessage is for the X diagnostic dumps whose lines list a whole table (curve
+// knots, ladder boundaries, trace rows); it only lives on the stack while they run.
+
+#define SHMESSAGE_CAPACITY      64
+#define SHMESSAGE_LONG_CAPACITY 128
+
+template <uint8_t Capacity>
+class SHMessageBuffer
+{
+private:
+	char _buf[Capacity];
+	uint8_t _len = 0;
+
+	void put(char c)
+	{
+		if (_len < Capacity)
+			_buf[_len++] = c;
+	}
+
+	template <typename T>
+	void digits(T v, const T* powers, uint8_t count)
+	{
+		bool started = false;
+		for (uint8_t i = 0; i < count; i++)
+		{
+			T p = readPower(&powers[i]);
+			char d = '0';
+			while (v >= p)
+			{
+				v -= p;
+				d++;
+			}
+			if (started || d != '0')
+			{
+				put(d);
+				started = true;
+			}
+		}
+		put('0' + (uint8_t)v);
+	}
+
+	static uint16_t readPower(const uint16_t* p) { return pgm_read_word(p); }
+	static uint32_t readPower(const uint32_t* p) { return pgm_read_dword(p); }
+
+public:
+	// Flash string (F("...")).
+	SHMessageBuffer& key(const __FlashStringHelper* s)
+	{
+		PGM_P p = reinterpret_cast<PGM_P>(s);
+		for (char c = pgm_read_byte(p); c != 0; c = pgm_read_byte(++p))
+			put(c);
+		return *this;
+	}
+
+	// RAM string.
+	SHMessageBuffer& text(const char* s)
+	{
+		while (*s)
+			put(*s++);
+		return *this;
+	}
+
+	SHMessageBuffer& ch(char c)
+	{
+		put(c);
+		return *this;
+	}
+
+	SHMessageBuffer& num(uint16_t v)
+	{
+		static const uint16_t powers[] PROGMEM = { 10000, 1000, 100, 10 };
+		digits<uint16_t>(v, powers, 4);
+		return *this;
+	}
+
+	SHMessageBuffer& num(uint32_t v)
+	{
+		if (v <= 0xFFFF)
+			return num((uint16_t)v);
+		static const uint32_t powers[] PROGMEM = { 1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL, 10000UL, 1000UL, 100UL, 10UL };
+		digits<uint32_t>(v, powers, 9);
+		return *this;
+	}
+
+	SHMessageBuffer& num(int16_t v)
+	{
+		if (v < 0)
+		{
+			put('-');
+			return num((uint16_t)(-(int32_t)v));
+		}
+		return num((uint16_t)v);
+	}
+
+	SHMessageBuffer& num(uint8_t v) { return num((uint16_t)v); }
+
+	// Two hex digits, uppercase.
+	SHMessageBuffer& hex8(uint8_t v)
+	{
+		static const char hex[] PROGMEM = "0123456789ABCDEF";
+		put(pgm_read_byte(&hex[v >> 4]));
+		put(pgm_read_byte(&hex[v & 0x0F]));
+		return *this;
+	}
+
+	// Flash string given as a PGM_P (PSTR(), PROGMEM tables).
+	SHMessageBuffer& key(PGM_P s) { return key(reinterpret_cast<const __FlashStringHelper*>(s)); }
+
+	// Decimal, or '-' when v equals none (a "not reached" marker).
+	SHMessageBuffer& numOr(uint16_t v, uint16_t none)
+	{
+		return v == none ? ch('-') : num(v);
+	}
+
+	void clear() { _len = 0; }
+	const char* data() const { return _buf; }
+	uint8_t length() const { return _len; }
+};
+
+typedef SHMessageBuffer<SHMESSAGE_CAPACITY> SHMessage;
+typedef SHMessageBuffer<SHMESSAGE_LONG_CAPACITY> SHLongMessage;
+
+#endif
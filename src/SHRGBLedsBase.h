@@ -3,27 +3,100 @@
 
 #include <Arduino.h>
 
+// Palette transport (modes 4-6): up to 16 colours uploaded once, then 4 bits per LED.
+#define RGBLEDS_PALETTE_SIZE 16
+
+// Static (CRTP) base: Driver derives from SHRGBLedsBase<Driver, Count, RightToLeft> and
+// supplies setPixelColor() and show(); present() and readPixels() have generic versions
+// here that a driver may hide with faster ones. Calls go through driver() and resolve at
+// compile time — no vtable, and the strip length and direction are constants, so a
+// per-pixel write inlines down to the index arithmetic and the driver's store.
+template <class Driver, uint8_t Count, bool RightToLeft>
 class SHRGBLedsBase {
 protected:
-	int _maxLeds;
-	int _righttoleft;
+	// Strip positions [_dirtyFirst, _dirtyEnd) changed since the last commit(); empty when _dirtyEnd is 0
+	uint8_t _dirtyFirst = 0xFF;
+	uint8_t _dirtyEnd = 0;
+	// read() is between its first and last byte: _back may hold part of a frame, and
+	// idle() work (scheduler tasks) runs from inside its serial reads.
+	bool _ingesting = false;
+	uint8_t _palette[RGBLEDS_PALETTE_SIZE][3];  // raw host colours, corrected on store
+
+	Driver& driver() { return *static_cast<Driver*>(this); }
+
+	// Makes LEDs [first, end) visible. Double-buffered drivers copy that range from the
+	// back buffer first. Only the first end LEDs need sending: LEDs past the end of a
+	// WS2812B data stream keep their latched colour.
+	void present(uint8_t first, uint8_t end) {
+		driver().show();
+	}
 
-	void begin(int maxLeds, int righttoleft) {
-		_maxLeds = maxLeds;
-		_righttoleft = righttoleft;
+	void markDirty(uint8_t led) {
+		if (led < _dirtyFirst) _dirtyFirst = led;
+		if (led >= _dirtyEnd) _dirtyEnd = led + 1;
 	}
 
-	virtual void setPixelColor(uint8_t lednumber, uint8_t r, uint8_t g, uint8_t b);
+	// One LED in host order (mode 2 and 3 ranges past the strip are dropped).
+	// Driver::setPixelColor() returns false when the LED already had that colour.
+	void setLed(uint16_t j, uint8_t r, uint8_t g, uint8_t b) {
+		if (j >= Count)
+			return;
+		uint8_t led = RightToLeft ? Count - 1 - j : j;
+		if (driver().setPixelColor(led, r, g, b))
+			markDirty(led);
+	}
 
-public:
+	void setLedIndexed(uint16_t j, uint8_t index) {
+		const uint8_t* c = _palette[index & (RGBLEDS_PALETTE_SIZE - 1)];
+		setLed(j, c[0], c[1], c[2]);
+	}
+
+	// count RGB triplets for LEDs start.. (host order), as sent by modes 1 and 2.
+	// Drivers with a directly addressable buffer hide this with a bulk path.
+	void readPixels(uint8_t start, uint8_t count) {
+		for (uint16_t j = start; j < start + count; j++) {
+			uint8_t r = FlowSerialTimedRead();
+			uint8_t g = FlowSerialTimedRead();
+			uint8_t b = FlowSerialTimedRead();
+			setLed(j, r, g, b);
+		}
+	}
 
-	virtual void show();
+public:
+	static const uint8_t LedCount = Count;
 
 	void clear() {
-		for (int j = 0; j < _maxLeds; j++) {
-			setPixelColor(j, 0, 0, 0);
+		for (uint8_t j = 0; j < Count; j++) {
+			driver().setPixelColor(j, 0, 0, 0);
+		}
+		_dirtyFirst = 0xFF;
+		_dirtyEnd = 0;
+		driver().present(0, Count);
+	}
+
+	// Local renderers (SHLedFx.h): one LED in host order, same change tracking as read().
+	void setColor(uint8_t j, uint8_t r, uint8_t g, uint8_t b) {
+		setLed(j, r, g, b);
+	}
+
+	// Pixels changed by read() and not yet shown. SimHub resends identical frames for
+	// static lights; those leave the strip clean and cost no show().
+	bool dirty() const { return _dirtyEnd > 0; }
+	// Nothing may be presented or rendered while true (see _ingesting).
+	bool ingesting() const { return _ingesting; }
+	uint8_t dirtyFirst() const { return _dirtyFirst; }
+	uint8_t dirtyEnd() const { return _dirtyEnd; }
+
+	// Present pending pixel data up to the last changed LED. The caller picks the moment
+	// (see SHLedCommit.h).
+	void commit() {
+		if (_dirtyEnd > 0) {
+			uint8_t first = _dirtyFirst;
+			uint8_t end = _dirtyEnd;
+			_dirtyFirst = 0xFF;
+			_dirtyEnd = 0;
+			driver().present(first, end);
 		}
-		show();
 	}
 
 	void read() {
@@ -34,23 +107,13 @@ public:
 		uint16_t b2;
 		uint8_t j;
 		int mode = 1;
+		_ingesting = true;
 		mode = FlowSerialTimedRead();
 		while (mode > 0)
 		{
 			// Read all
 			if (mode == 1) {
-				for (j = 0; j < _maxLeds; j++) {
-					r = FlowSerialTimedRead();
-					g = FlowSerialTimedRead();
-					b = FlowSerialTimedRead();
-
-					if (_righttoleft == 1) {
-						setPixelColor(_maxLeds - j - 1, r, g, b);
-					}
-					else {
-						setPixelColor(j, r, g, b);
-					}
-				}
+				driver().readPixels(0, Count);
 			}
 
 			// partial led data
@@ -58,19 +121,7 @@ public:
 				int startled = FlowSerialTimedRead();
 				int numleds = FlowSerialTimedRead();
 
-				for (j = startled; j < startled + numleds; j++) {
-					/*	if (ENABLE_BLUETOOTH == 0) {*/
-					r = FlowSerialTimedRead();
-					g = FlowSerialTimedRead();
-					b = FlowSerialTimedRead();
-
-					if (_righttoleft == 1) {
-						setPixelColor(_maxLeds - j - 1, r, g, b);
-					}
-					else {
-						setPixelColor(j, r, g, b);
-					}
-				}
+				driver().readPixels(startled, numleds);
 			}
 
 			// repeated led data
@@ -83,21 +134,57 @@ public:
 				b = FlowSerialTimedRead();
 
 				for (j = startled; j < startled + numleds; j++) {
-					if (_righttoleft == 1) {
-						setPixelColor(_maxLeds - j - 1, r, g, b);
+					setLed(j, r, g, b);
+				}
+			}
+
+			// palette upload: first index, count, count RGB triplets
+			else if (mode == 4) {
+				uint8_t first = FlowSerialTimedRead();
+				uint8_t count = FlowSerialTimedRead();
+
+				for (j = 0; j < count; j++) {
+					uint8_t* c = _palette[(first + j) & (RGBLEDS_PALETTE_SIZE - 1)];
+					c[0] = FlowSerialTimedRead();
+					c[1] = FlowSerialTimedRead();
+					c[2] = FlowSerialTimedRead();
+				}
+			}
+
+			// palette indexed led data: 4 bits per led, high nibble first (13 bytes for 25 leds)
+			else if (mode == 5) {
+				uint16_t startled = FlowSerialTimedRead();
+				uint16_t numleds = FlowSerialTimedRead();
+				uint8_t packed = 0;
+
+				for (uint16_t i = 0; i < numleds; i++) {
+					if ((i & 1) == 0) {
+						packed = FlowSerialTimedRead();
+						setLedIndexed(startled + i, packed >> 4);
 					}
 					else {
-						setPixelColor(j, r, g, b);
+						setLedIndexed(startled + i, packed);
 					}
 				}
 			}
 
-			mode = FlowSerialTimedRead();
-		}
+			// palette run-length led data: run count, then one byte per run,
+			// high nibble run length - 1 (1-16 leds), low nibble palette index
+			else if (mode == 6) {
+				uint16_t led = FlowSerialTimedRead();
+				uint8_t runs = FlowSerialTimedRead();
 
-		if (_maxLeds > 0) {
-			show();
+				for (j = 0; j < runs; j++) {
+					uint8_t run = FlowSerialTimedRead();
+					for (uint8_t n = (run >> 4) + 1; n > 0; n--) {
+						setLedIndexed(led++, run);
+					}
+				}
+			}
+
+			mode = FlowSerialTimedRead();
 		}
+		_ingesting = false;
 	}
 };
 
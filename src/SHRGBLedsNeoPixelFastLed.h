@@ -5,26 +5,47 @@
 
 #include <Arduino.h>
 #include "SHRGBLedsBase.h"
+#include "SHLedGamma.h"
 #include <FastLED.h>
 
-CRGB SHRGBLedsNeoPixelFastLeds_leds[WS2812B_RGBLEDCOUNT];
-
-class SHRGBLedsNeoPixelFastLeds : public SHRGBLedsBase {
+// WS2812B through FastLED, specialised at compile time on channel order (0 GRB, 1 RGB,
+// 2 BRG), direction and strip length; SHRGBLedsNeoPixelFastLeds below binds them to the
+// hardwareSettings.h values.
+//
+// Double buffered: ingest and local renderers write _back, FastLED sends _front.
+// present() copies the dirty range across just before a show. It is only called outside
+// read() (commit() after the command, service() gated on ingesting()), so the copy never
+// picks up a frame that is still being received.
+template <uint8_t Encoding, bool RightToLeft, uint8_t Count>
+class SHRGBLedsNeoPixelFastLedsT : public SHRGBLedsBase<SHRGBLedsNeoPixelFastLedsT<Encoding, RightToLeft, Count>, Count, RightToLeft> {
 private:
+	typedef SHRGBLedsBase<SHRGBLedsNeoPixelFastLedsT<Encoding, RightToLeft, Count>, Count, RightToLeft> Base;
+	friend Base;
+
 	unsigned long lastRead = 0;
+	CLEDController* controller = 0;
+	uint16_t scale = LED_BRIGHTNESS_FULL;
+	CRGB _front[Count];
+	CRGB _back[Count];
+
+	// Channel order; Encoding is a constant, so this folds to three stores.
+	static CRGB encode(uint8_t r, uint8_t g, uint8_t b) {
+		return Encoding == 1 ? CRGB(g, r, b) : Encoding == 2 ? CRGB(b, g, r) : CRGB(r, g, b);
+	}
 
 public:
 
+	// maxLeds and righttoleft are the template's Count and RightToLeft; kept for the
+	// sketch's begin() call.
 	void begin(int maxLeds, int righttoleft, bool testMode) {
-		SHRGBLedsBase::begin(maxLeds, righttoleft);
-		FastLED.addLeds<NEOPIXEL, WS2812B_DATAPIN>(SHRGBLedsNeoPixelFastLeds_leds, maxLeds);
+		controller = &FastLED.addLeds<NEOPIXEL, WS2812B_DATAPIN>(_front, Count);
 
 		if (testMode > 0) {
-			for (int i = 0; i < maxLeds; i++) {
+			for (uint8_t i = 0; i < Count; i++) {
 				setPixelColor(i, 255, 0, 0);
 			}
 		}
-		FastLED.show();
+		present(0, Count);
 	}
 
 	void show() {
@@ -32,21 +53,54 @@ public:
 		//delay(10);
 	}
 
+	// Global dimming in percent (LB: token), applied to data ingested from now on.
+	void setBrightness(uint8_t percent) {
+		scale = ledBrightnessScale(percent);
+	}
+
 protected:
-	void setPixelColor(uint8_t lednumber, uint8_t r, uint8_t g, uint8_t b) {
-		// 0 for GRB, 
-		// 1 for RGB encoding
-		// 2 for BRG encoding
-		if (WS2812B_RGBENCODING == 0) {
-			SHRGBLedsNeoPixelFastLeds_leds[lednumber].setRGB(r, g, b);
-		}
-		else if (WS2812B_RGBENCODING == 1) {
-			SHRGBLedsNeoPixelFastLeds_leds[lednumber].setRGB(g, r, b);
-		}
-		else if (WS2812B_RGBENCODING == 2) {
-			SHRGBLedsNeoPixelFastLeds_leds[lednumber].setRGB(b, g, r);
+	// ~30 µs per LED with interrupts off, so only send up to the last changed one.
+	void present(uint8_t first, uint8_t end) {
+		memcpy(_front + first, _back + first, (end - first) * sizeof(CRGB));
+		controller->setLeds(_front, end);
+		FastLED.show();
+		controller->setLeds(_front, Count);
+	}
+
+	// Bulk ingest: walks contiguous spans borrowed from the ARQ data buffer and stores
+	// straight into the back buffer. Per-byte read() calls (idle function, timeout check)
+	// become one call per span.
+	void readPixels(uint8_t start, uint8_t count) {
+		uint16_t left = (uint16_t)count * 3;
+		uint16_t j = start;
+		uint8_t rgb[3];
+		uint8_t k = 0;
+		while (left > 0) {
+			const uint8_t* span;
+			uint8_t n = arqserial.peekSpan(span, left > 255 ? 255 : (uint8_t)left);
+			if (n == 0)
+				return; // timeout: the mode loop ends on the next read
+			left -= n;
+			for (uint8_t i = 0; i < n; i++) {
+				rgb[k] = span[i];
+				if (++k == 3) {
+					k = 0;
+					this->setLed(j++, rgb[0], rgb[1], rgb[2]);
+				}
+			}
+			arqserial.consume(n);
 		}
 	}
+
+	bool setPixelColor(uint8_t lednumber, uint8_t r, uint8_t g, uint8_t b) {
+		CRGB c = encode(ledCorrect(r, scale), ledCorrect(g, scale), ledCorrect(b, scale));
+		if (_back[lednumber] == c)
+			return false;
+		_back[lednumber] = c;
+		return true;
+	}
 };
 
-#endif
\ No newline at end of file
+typedef SHRGBLedsNeoPixelFastLedsT<WS2812B_RGBENCODING, WS2812B_RIGHTTOLEFT == 1, WS2812B_RGBLEDCOUNT> SHRGBLedsNeoPixelFastLeds;
+
+#endif
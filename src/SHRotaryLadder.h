@@ -0,0 +1,216 @@
+#pragma once
+#include <Arduino.h>
+#include "SHEepromStore.h"
+
+// Self-calibrating decoder for the 12-position 2.7kΩ resistor-ladder rotaries (A0-A3).
+//
+// Each channel keeps the learned ADC level of every position (×16 fixed point). Decision
+// boundaries are the midpoints between adjacent levels, so they follow ladder tolerance,
+// temperature and VCC drift as the levels are learned. A reading is only learned once
+// the decoded position has been stable for LADDER_STABLE_READS scans and it sits within
+// LADDER_CAPTURE_WINDOW of the current level (i.e. the wiper is not mid-travel).
+// Hysteresis follows the learned noise: an EMA (same 1/32 weight as the levels) of the
+// reading-to-reading jitter while stable, times LADDER_HYST_JITTER_GAIN, plus one count.
+// One noisy pair of readings only nudges it, and it comes back down when the noise does.
+//
+// Learned ladders are committed to EEPROM (CRC-protected, EEPROM_ADDR_LADDER) at most once
+// per LADDER_SAVE_INTERVAL and restored by begin(); "X ladder" dumps them. The commit runs
+// from the persist task, i.e. possibly inside ARQ's serial reads, so it is written a few
+// cells at a time while the link is quiet (SHEepromStore::saveStep).
+#define LADDER_CHANNELS        4
+#define LADDER_POSITIONS       12
+#define LADDER_RECORD_VERSION  1
+#define LADDER_STABLE_READS    8        // 80 ms at the 10 ms scan rate
+#define LADDER_LEARN_SHIFT     5        // EMA weight 1/32 per learned reading
+#define LADDER_CAPTURE_WINDOW  32       // counts — farther readings are never learned
+#define LADDER_MIN_GAP         24       // counts — learned levels never get closer than this
+#define LADDER_DEFAULT_HYST    3        // counts — bench noise ≤3
+#define LADDER_MIN_HYST        2        // counts
+#define LADDER_MAX_HYST        12       // counts
+#define LADDER_HYST_JITTER_GAIN 2       // hysteresis = gain × mean jitter + 1 (mean |Δ| ≈ 1.1σ)
+#define LADDER_SAVE_INTERVAL   300000UL // ms between EEPROM commits of a drifted ladder
+
+// Factory levels from the bench measurement (step ≈85, noise ≤3 counts).
+static const uint16_t LADDER_DEFAULT_LEVELS[LADDER_POSITIONS] PROGMEM = {
+    84, 169, 254, 339, 423, 507, 592, 677, 762, 848, 935, 1023,
+};
+
+struct LadderRecord
+{
+    uint16_t level[LADDER_POSITIONS]; // learned ADC level per position, ×16
+    uint8_t  hysteresis;              // counts a reading may overshoot a boundary before the position changes
+};
+
+class SHRotaryLadder
+{
+private:
+    LadderRecord _ch[LADDER_CHANNELS];
+    uint8_t _stable[LADDER_CHANNELS] = {};
+    uint16_t _prevAdc[LADDER_CHANNELS] = {};
+    uint16_t _jitter[LADDER_CHANNELS] = {}; // mean reading-to-reading jitter while stable, ×256 (EMA)
+    uint8_t _dirty  = 0; // bitmask of channels with unsaved changes
+    uint8_t _stored = 0; // bitmask of channels restored from EEPROM at boot
+    bool _forceSave = false;
+    unsigned long _lastSave = 0;
+    uint8_t _saveCh  = LADDER_CHANNELS; // channel being written, LADDER_CHANNELS = none
+    uint8_t _savePos = 0;               // saveStep() cursor into its record
+
+    static int recordAddress(uint8_t ch)
+    {
+        return EEPROM_ADDR_LADDER + ch * (sizeof(LadderRecord) + 1);
+    }
+
+    void loadDefaults(uint8_t ch)
+    {
+        for (uint8_t i = 0; i < LADDER_POSITIONS; i++)
+            _ch[ch].level[i] = pgm_read_word(&LADDER_DEFAULT_LEVELS[i]) << 4;
+        _ch[ch].hysteresis = LADDER_DEFAULT_HYST;
+    }
+
+    // Start the jitter estimate at the value the current hysteresis corresponds to.
+    void seedJitter(uint8_t ch)
+    {
+        _jitter[ch] = ((uint16_t)(_ch[ch].hysteresis - 1) << 8) / LADDER_HYST_JITTER_GAIN;
+    }
+
+    void learn(uint8_t ch, uint16_t adc, uint8_t pos)
+    {
+        uint16_t jitter = (uint16_t)abs((int16_t)adc - (int16_t)_prevAdc[ch]);
+        _prevAdc[ch] = adc;
+        if (_stable[ch] < LADDER_STABLE_READS)
+        {
+            _stable[ch]++;
+            return;
+        }
+
+        LadderRecord& r = _ch[ch];
+        uint16_t& lv = r.level[pos - 1];
+        if (abs((int16_t)adc - (int16_t)(lv >> 4)) > LADDER_CAPTURE_WINDOW)
+            return;
+
+        // Jitter between two stable readings is noise, independent of any level offset.
+        // Clip it so a single glitch cannot move the estimate by more than a count.
+        if (jitter > LADDER_MAX_HYST)
+            jitter = LADDER_MAX_HYST;
+        int16_t jd = (int16_t)(jitter << 8) - (int16_t)_jitter[ch];
+        _jitter[ch] += (jd + (1 << (LADDER_LEARN_SHIFT - 1))) >> LADDER_LEARN_SHIFT;
+        uint16_t hyst = ((LADDER_HYST_JITTER_GAIN * _jitter[ch] + 255) >> 8) + 1;
+        hyst = constrain(hyst, LADDER_MIN_HYST, LADDER_MAX_HYST);
+        if (hyst != r.hysteresis)
+        {
+            r.hysteresis = hyst;
+            _dirty |= (1 << ch);
+        }
+
+        uint16_t before = lv >> 4;
+        int16_t delta = (int16_t)(adc << 4) - (int16_t)lv;
+        int16_t next  = (int16_t)lv + ((delta + (1 << (LADDER_LEARN_SHIFT - 1))) >> LADDER_LEARN_SHIFT);
+
+        // Keep levels strictly ordered so every boundary stays between its two positions.
+        int16_t lo = (pos > 1) ? (int16_t)(r.level[pos - 2] + (LADDER_MIN_GAP << 4)) : 0;
+        int16_t hi = (pos < LADDER_POSITIONS) ? (int16_t)(r.level[pos] - (LADDER_MIN_GAP << 4)) : (1023 << 4);
+        lv = (uint16_t)constrain(next, lo, hi);
+
+        if ((lv >> 4) != before)
+            _dirty |= (1 << ch);
+    }
+
+public:
+    void begin()
+    {
+        for (uint8_t ch = 0; ch < LADDER_CHANNELS; ch++)
+        {
+            if (SHEepromStore::load(recordAddress(ch), LADDER_RECORD_VERSION, &_ch[ch], sizeof(LadderRecord)))
+                _stored |= (1 << ch);
+            else
+                loadDefaults(ch);
+            seedJitter(ch);
+        }
+    }
+
+    // Back to factory levels; persisted by the following service() calls.
+    void reset()
+    {
+        for (uint8_t ch = 0; ch < LADDER_CHANNELS; ch++)
+        {
+            loadDefaults(ch);
+            seedJitter(ch);
+        }
+        _dirty = (1 << LADDER_CHANNELS) - 1;
+        _forceSave = true;
+    }
+
+    // Boundary between position pos and pos+1 (1-based): midpoint of the two learned levels.
+    uint16_t boundary(uint8_t ch, uint8_t pos) const
+    {
+        return (_ch[ch].level[pos - 1] + _ch[ch].level[pos]) >> 5;
+    }
+
+    uint8_t hysteresis(uint8_t ch) const { return _ch[ch].hysteresis; }
+    bool isStored(uint8_t ch) const { return _stored & (1 << ch); }
+
+    // Decode an ADC reading to position 1-12. current = last decoded position (0 = none).
+    // O(1): the current band (widened by the hysteresis) is checked first; otherwise an
+    // equal-step estimate is corrected against the learned boundaries, which is at most
+    // one step unless the ladder is badly skewed.
+    uint8_t decode(uint8_t ch, uint16_t adc, uint8_t current)
+    {
+        uint8_t hyst = _ch[ch].hysteresis;
+        if (current >= 1 && current <= LADDER_POSITIONS
+            && (current == 1 || adc + hyst > boundary(ch, current - 1))
+            && (current == LADDER_POSITIONS || adc <= boundary(ch, current) + hyst))
+        {
+            learn(ch, adc, current);
+            return current;
+        }
+        _prevAdc[ch] = adc;
+
+        // 771/65536 ≈ 1/85 (nominal step), rounded to the nearest level.
+        uint8_t pos = (uint8_t)(((uint32_t)(adc + 42) * 771) >> 16);
+        pos = constrain(pos, 1, LADDER_POSITIONS);
+        while (pos > 1 && adc <= boundary(ch, pos - 1))
+            pos--;
+        while (pos < LADDER_POSITIONS && adc > boundary(ch, pos))
+            pos++;
+
+        _stable[ch] = 0;
+        return pos;
+    }
+
+    // Called from the persist task (lastRx from ArqSerial::lastRx()). Once
+    // LADDER_SAVE_INTERVAL has elapsed, commits drifted ladders one channel at a time and
+    // one bounded step per quiet call. A channel re-learned mid-pass is written again, so
+    // the stored CRC always ends up matching a consistent record.
+    void service(unsigned long now, unsigned long lastRx)
+    {
+        if (_saveCh == LADDER_CHANNELS)
+        {
+            if (_dirty == 0 || (!_forceSave && now - _lastSave < LADDER_SAVE_INTERVAL))
+                return;
+            _saveCh = 0;
+            while (!(_dirty & (1 << _saveCh)))
+                _saveCh++;
+            _dirty &= ~(1 << _saveCh);
+            _savePos = 0;
+        }
+
+        if (!SHEepromStore::linkQuiet(now, lastRx))
+            return;
+        if (!SHEepromStore::saveStep(recordAddress(_saveCh), LADDER_RECORD_VERSION, &_ch[_saveCh], sizeof(LadderRecord), _savePos))
+            return;
+
+        if (_dirty & (1 << _saveCh))
+        {
+            _dirty &= ~(1 << _saveCh); // changed while being written: another pass
+            return;
+        }
+        _stored |= (1 << _saveCh);
+        _saveCh = LADDER_CHANNELS;
+
+        if (_dirty == 0)
+        {
+            _lastSave  = now;
+            _forceSave = false;
+        }
+    }
+};
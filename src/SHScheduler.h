@@ -0,0 +1,129 @@
+#ifndef __SHSCHEDULER_H__
+#define __SHSCHEDULER_H__
+
+#include <Arduino.h>
+
+// Cooperative task scheduler driven from idle().
+//
+// Every pass samples millis() exactly once and hands that value to each task, so all
+// work done in one pass shares a single timebase. A periodic task is released when its
+// due time has passed; the next due time advances by one period (phase-locked) unless
+// the task ran later than its deadline, in which case the missed releases are counted
+// as one overrun and the task re-phases to "now" instead of bursting to catch up.
+// Tasks with period 0 run on every pass.
+//
+// Tasks run in registration order, so register producers before consumers
+// (e.g. input scan before SR commit).
+//
+// main.cpp registers 8 tasks with INCLUDE_WS2812B. The table keeps two spare slots, and an
+// add() that finds it full is counted (rejected(), REJ in X sched) rather than lost silently.
+
+#define SCHEDULER_MAX_TASKS 10
+
+typedef void (*SHTaskFunction)(unsigned long now);
+
+class SHScheduler
+{
+private:
+	struct Task
+	{
+		SHTaskFunction fn;
+		const char* name;      // PROGMEM string, for X sched
+		unsigned long due;
+		uint16_t period;       // ms, 0 = every pass
+		uint16_t deadline;     // ms of release lateness tolerated before an overrun is counted
+		uint16_t overruns;
+		uint16_t maxLateness;  // ms, worst release lateness seen
+	};
+
+	Task _tasks[SCHEDULER_MAX_TASKS];
+	uint8_t _count = 0;
+	uint8_t _rejected = 0;     // add() calls that found the table full
+	unsigned long _now = 0;
+	bool _running = false;
+
+public:
+	// Register a task. name must be a PROGMEM string (PSTR("...")).
+	// Returns false when the table is full.
+	bool add(const char* name, SHTaskFunction fn, uint16_t period, uint16_t deadline)
+	{
+		if (_count >= SCHEDULER_MAX_TASKS)
+		{
+			if (_rejected < 0xFF)
+				_rejected++;
+			return false;
+		}
+		Task& t = _tasks[_count++];
+		t.fn = fn;
+		t.name = name;
+		t.due = millis();
+		t.period = period;
+		t.deadline = deadline;
+		t.overruns = 0;
+		t.maxLateness = 0;
+		return true;
+	}
+
+	// One scheduler pass. Re-entrant calls (idle() invoked from a serial read made by a
+	// task) return immediately.
+	void run()
+	{
+		if (_running)
+			return;
+		_running = true;
+		_now = millis();
+
+		for (uint8_t i = 0; i < _count; i++)
+		{
+			Task& t = _tasks[i];
+			if (t.period == 0)
+			{
+				t.fn(_now);
+				continue;
+			}
+
+			unsigned long late = _now - t.due;
+			if ((long)late < 0)
+				continue;
+
+			if (late > t.maxLateness)
+				t.maxLateness = late > 0xFFFF ? 0xFFFF : (uint16_t)late;
+
+			if (late > t.deadline)
+			{
+				if (t.overruns < 0xFFFF)
+					t.overruns++;
+				t.due = _now + t.period;
+			}
+			else
+			{
+				t.due += t.period;
+			}
+			t.fn(_now);
+		}
+
+		_running = false;
+	}
+
+	// Timebase of the current (or last) pass.
+	unsigned long now() const { return _now; }
+
+	uint8_t count() const { return _count; }
+	uint8_t rejected() const { return _rejected; }
+	const char* name(uint8_t i) const { return _tasks[i].name; }
+	uint16_t period(uint8_t i) const { return _tasks[i].period; }
+	uint16_t deadline(uint8_t i) const { return _tasks[i].deadline; }
+	uint16_t overruns(uint8_t i) const { return _tasks[i].overruns; }
+	uint16_t maxLateness(uint8_t i) const { return _tasks[i].maxLateness; }
+
+	void resetStats()
+	{
+		for (uint8_t i = 0; i < _count; i++)
+		{
+			_tasks[i].overruns = 0;
+			_tasks[i].maxLateness = 0;
+		}
+	}
+};
+
+#endif
@@ -1,5 +1,4 @@
 
-#include "SHDebouncer.h"
 
 // ----------------------------------------------------- HW SETTINGS, PLEASE REVIEW ALL -------------------------------------------
 #define DEVICE_NAME "Redbull RB19 Steering Interface Pre-Processor" //{"Group":"General","Name":"DEVICE_NAME","Title":"Device name,\r\n make sure to use a unique name when using multiple arduinos","DefaultValue":"SimHub Dash","Type":"string","Template":"#define DEVICE_NAME \"{0}\""}
@@ -505,8 +504,6 @@ SHButton *BUTTONS[] = {&button1, &button2, &button3, &button4, &button5, &button
 
 #endif
 
-SHDebouncer ButtonsDebouncer(10);
-
 // ----------------------- ROTARY ENCODERS ------------------------------------------------------------------
 // https://www.dx.com/p/ky-040-rotary-encoder-module-brick-sensor-development-for-arduino-avr-pic-420429#.W9BCM0sza0Q
 // Rotary encoders with pull-up resistors on the 3 outputs
@@ -19,20 +19,47 @@
 #include "SHButton.h"
 #include "SHClutchPWM.h"
 #include "SHDualClutchSensor.h"
+#include "SHScheduler.h"
+#include "SHInputPlane.h"
+#include "SHClutchStream.h"
+#include "SHLaunchRecorder.h"
+#include "SHLedCommit.h"
+#include "SHLedFx.h"
+#include "SHMemory.h"
 
 #include <hardwareSettings.h>
 
 #include "SHCustomProtocol.h"
 SHCustomProtocol shCustomProtocol;
-#include "SHCommands.h"
-#include "SHCommandsGlcd.h"
-unsigned long lastMatrixRefresh = 0;
-
+// Cooperative scheduler run from idle(); tasks are registered in setup()
+SHScheduler shScheduler;
+// 1 kHz Timer2 input plane: ADC, clutch → PWM, encoder drain, SR commit
+SHInputPlane shInputPlane;
+#if CLUTCH_LATENCY_PROBE
+// Clutch sample → OCR1A stage timing, reported by X clutchlat
+SHLatencyProbe shLatencyProbe;
+#endif
 // Clutch PWM controller instance
 SHClutchPWM shClutchPWM;
-
 // Dual clutch sensor instance (Hall effect sensors on A4, A5)
 SHDualClutchSensor shDualClutchSensor;
+// Binary clutch sample stream (X clutchstream)
+SHClutchStream shClutchStream;
+// Paddle-release flight recorder (X launch)
+SHLaunchRecorder shLaunchRecorder;
+// WS2812B show timing relative to the serial link (X linkstats)
+SHLedCommit shLedCommit;
+// On-device shift lights / flags from X ledfx telemetry
+SHLedFx shLedFx;
+// Heap peak and stack paint scan (X mem)
+SHMemory shMemory;
+#include "SHCommands.h"
+#include "SHCommandsGlcd.h"
+#include "SHCommandsCustom.h"
+unsigned long lastMatrixRefresh = 0;
+
+// Double-buffered packed input state, captured once per input scan
+InputSnapshotBuffer inputSnapshots;
 
 // Forward declaration for the callback functions
 void buttonStatusChanged(int buttonId, byte Status);
@@ -40,58 +67,162 @@ void expandedButtonChanged(int buttonId, byte Status);
 void clutchSimHubUpdate(uint16_t pwmValue);
 void onClutchSensorsChanged(uint16_t clutchA, uint16_t clutchB);
 void onCalibrationReceived(uint16_t restA, uint16_t fullA, uint16_t restB, uint16_t fullB);
+void onCurveReceived(const uint16_t* knots);
+void queueExpandedButton(int buttonId, byte Status);
 
-void idle(bool critical)
+// ---- Input plane (Timer2 tick, interrupt context) ----
+
+// Fresh clutch A/B pair: filter, calibrate and calculate combined PWM with bite point
+void inputPlaneClutchSample(uint16_t rawA, uint16_t rawB)
 {
+#if CLUTCH_LATENCY_PROBE
+	CLUTCH_LATENCY_START(shInputPlane.clutchSampleUs());
+	CLUTCH_LATENCY_MARK(LATENCY_STAGE_PICKUP);
+#endif
+	shDualClutchSensor.update(rawA, rawB, onClutchSensorsChanged);
+	shClutchStream.capture(shDualClutchSensor);
+	shLaunchRecorder.capture(shDualClutchSensor.stageValue(SHDualClutchSensor::STAGE_CALIBRATED, 0),
+		shDualClutchSensor.stageValue(SHDualClutchSensor::STAGE_CALIBRATED, 1),
+		shCustomProtocol.getLastCombined(), shCustomProtocol.getClutchBitePoint());
+}
+
+// Encoder drain, SR pulse expiry and SR commit. SimHub-routed events are queued.
+void inputPlaneTick(unsigned long now)
+{
+	expandedInputs.serviceEncoder(now, queueExpandedButton);
+	expandedInputs.commitSr();
+}
+
+// Timer2 compare match, 1 kHz. ISR_NOBLOCK so USART RX is never held off by a tick.
+ISR(TIMER2_COMPA_vect, ISR_NOBLOCK)
+{
+	shInputPlane.tick();
+}
+
+#if CLUTCH_DITHER_BITS > 0
+// Sigma-delta dither of the clutch PWM, once per carrier period
+ISR(TIMER1_OVF_vect)
+{
+	shClutchPWM.ditherStep();
+}
+#endif
 
+// ADC conversion complete — background clutch oversampling / ladder stream.
+ISR(ADC_vect)
+{
+	shInputPlane.adcComplete();
+}
+
+// ---- Scheduler tasks (main loop) ----
+
+// Event drain (every pass): SimHub encoders and button events queued by the input plane.
+void taskEvents(unsigned long now)
+{
 #if ENABLED_ENCODERS_COUNT > 0
 	for (int i = 0; i < ENABLED_ENCODERS_COUNT; i++)
 	{
 		SHRotaryEncoders[i]->read();
 	}
 #endif
+	int buttonId;
+	byte status;
+	while (shInputPlane.popButtonEvent(buttonId, status))
+		buttonStatusChanged(buttonId, status);
+}
 
-	// Read dual clutch sensors and calculate combined PWM with bite point
-	shDualClutchSensor.read(onClutchSensorsChanged);
-
-	if (ButtonsDebouncer.Debounce())
+// Input scan: rotary ladders (from the input plane's ADC cache) and buttons,
+// then report the snapshot diff.
+void taskInputScan(unsigned long now)
+{
+	if (shCustomProtocol.takeSimHubPositionsUpdate())
 	{
-		bool changed = false;
-
 		const uint8_t* shp = shCustomProtocol.getSimHubPositions();
 		expandedInputs.setSimHubPositions(shp[0], shp[1], shp[2]);
-		expandedInputs.readAll(expandedButtonChanged);
-
-		// Send ROT1-4 on position change. On-connect and periodic sends are
-		// handled by SHCustomProtocol::read() and SHCustomProtocol::idle().
-		static int lastSentRotaryPos  = -1;
-		static int lastSentRotary2Pos = -1;
-		static int lastSentRotary3Pos = -1;
-		static int lastSentRotary4Pos = -1;
-
-		int currentPos  = expandedInputs.getRotaryPosition();
-		int currentPos2 = expandedInputs.getRotary2Position();
-		int currentPos3 = expandedInputs.getRotary3Position();
-		int currentPos4 = expandedInputs.getRotary4Position();
-
-		shCustomProtocol.setRotaryPosition( (uint8_t)currentPos);
-		shCustomProtocol.setRotary2Position((uint8_t)currentPos2);
-		shCustomProtocol.setRotary3Position((uint8_t)currentPos3);
-		shCustomProtocol.setRotary4Position((uint8_t)currentPos4);
-
-		if (currentPos  != lastSentRotaryPos)  { lastSentRotaryPos  = currentPos;  shCustomProtocol.sendRotaryPosition();  }
-		if (currentPos2 != lastSentRotary2Pos) { lastSentRotary2Pos = currentPos2; shCustomProtocol.sendRotary2Position(); }
-		if (currentPos3 != lastSentRotary3Pos) { lastSentRotary3Pos = currentPos3; shCustomProtocol.sendRotary3Position(); }
-		if (currentPos4 != lastSentRotary4Pos) { lastSentRotary4Pos = currentPos4; shCustomProtocol.sendRotary4Position(); }
+	}
+	uint16_t ladderAdc[LADDER_CHANNELS];
+	shInputPlane.copyLadderAdc(ladderAdc);
+	expandedInputs.scanRotaries(ladderAdc);
 
 #ifdef INCLUDE_BUTTONS
-		for (int btnIdx = 0; btnIdx < ENABLED_BUTTONS_COUNT; btnIdx++)
-		{
-			BUTTONS[btnIdx]->read();
-		}
+	for (int btnIdx = 0; btnIdx < ENABLED_BUTTONS_COUNT; btnIdx++)
+	{
+		BUTTONS[btnIdx]->read();
+	}
 #endif
+
+	// Capture this scan into the snapshot and report only what changed since the last
+	// acknowledged one. On-connect and periodic ROT sends are handled by
+	// SHCustomProtocol::read() and the heartbeat task.
+	InputSnapshot& snap = inputSnapshots.current();
+	expandedInputs.capture(snap);
+
+	uint8_t changed = inputSnapshots.diff();
+	if (changed)
+	{
+		shCustomProtocol.reportInputChanges(snap, changed);
+		inputSnapshots.acknowledge();
 	}
+}
+
+void taskTelemetry(unsigned long now)
+{
+	shCustomProtocol.sendTelemetry();
+}
+
+// Drains captured clutch samples into binary packets while X clutchstream is on.
+void taskClutchStream(unsigned long now)
+{
+	shClutchStream.service(now);
+}
+
+// Deferred EEPROM writes that must not run inside a command before its ack. Runs from
+// idle(), so also inside ARQ reads: the curve and the learned ladders only write a few
+// cells per pass, and only while the link is quiet (SHEepromStore::saveStep).
+void taskPersist(unsigned long now)
+{
+	shDualClutchSensor.getCurve().service(now, arqserial.lastRx());
+	expandedInputs.getLadder().service(now, arqserial.lastRx());
+}
+
+void taskHeartbeat(unsigned long now)
+{
+	shCustomProtocol.sendHeartbeat();
+}
+
+// Deferred LED show, once the link has gone quiet (SHLedCommit.h).
+void taskLedCommit(unsigned long now)
+{
+#ifdef INCLUDE_WS2812B
+	// Runs from idle(), so also from inside the '6' command's serial reads: a link that
+	// stalls mid-frame (NAck and resend) must not get the half-written frame shown.
+	if (shRGBLedsWS2812B.ingesting())
+		return;
+#endif
+	shLedCommit.service(ShowRGBLeds, now, arqserial.lastRx());
+}
+
+#ifdef INCLUDE_WS2812B
+void ledFxPixel(uint8_t led, uint8_t r, uint8_t g, uint8_t b)
+{
+	shRGBLedsWS2812B.setColor(led, r, g, b);
+}
+
+// Fixed-rate effect frames between telemetry packets (blinks); shown in the next safe
+// slot or once the link is quiet.
+void taskLedFx(unsigned long now)
+{
+	if (!shLedFx.active(now) || shRGBLedsWS2812B.ingesting())
+		return;
+	shLedFx.render(now, ledFxPixel);
+	if (shRGBLedsWS2812B.dirty())
+		shLedCommit.request();
+}
+#endif
 
+void idle(bool critical)
+{
+	shMemory.sample();
+	shScheduler.run();
 	shCustomProtocol.idle();
 }
 
@@ -133,25 +264,37 @@ void buttonStatusChanged(int buttonId, byte Status)
 #endif
 }
 
-// Wrapper for expandedInputs: only forward SimHub positions (8-10, IDs 100-108).
-// Positions 1-7 and 11-12 (IDs 0-35) reach the 32u4 via the 74HC595 shift register.
+// Wrapper for expandedInputs: only forward SimHub-routed events (IDs 100-135).
+// SR-routed events (IDs 0-35) reach the 32u4 via the 74HC595 shift register.
 void expandedButtonChanged(int buttonId, byte Status)
 {
 	if (buttonId < 100) return;
 	buttonStatusChanged(buttonId, Status);
 }
 
+// Input-plane variant: the tick must not touch the serial link, so SimHub-routed events
+// are queued and sent by taskEvents().
+void queueExpandedButton(int buttonId, byte Status)
+{
+	if (buttonId < 100) return;
+	shInputPlane.pushButtonEvent(buttonId, Status);
+}
+
 void clutchSimHubUpdate(uint16_t pwmValue)
 {
 	shClutchPWM.setValue(pwmValue);
 }
 
+// clutchA/B are CLUTCH_AXIS_BITS wide; SimHub telemetry stays 10-bit.
 void onClutchSensorsChanged(uint16_t clutchA, uint16_t clutchB)
 {
-	shCustomProtocol.setClutchValues(clutchA, clutchB);
+	CLUTCH_LATENCY_MARK(LATENCY_STAGE_FILTER);
+	shCustomProtocol.setClutchValues(SHDualClutchSensor::toHostUnits(clutchA), SHDualClutchSensor::toHostUnits(clutchB));
 	// Calculate combined PWM with current bite point
 	uint16_t combinedPWM = shCustomProtocol.calculateCombinedPWM(clutchA, clutchB);
-	shClutchPWM.setValue(combinedPWM);
+	CLUTCH_LATENCY_MARK(LATENCY_STAGE_COMBINE);
+	shClutchPWM.setAxis(combinedPWM, CLUTCH_AXIS_BITS);
+	CLUTCH_LATENCY_MARK(LATENCY_STAGE_PWM);
 }
 
 // Fired by SHCustomProtocol when SimHub sends runtime calibration values.
@@ -159,9 +302,24 @@ void onClutchSensorsChanged(uint16_t clutchA, uint16_t clutchB)
 // See Architecture.md -> "Runtime Calibration via SimHub Protocol" for the expression string.
 void onCalibrationReceived(uint16_t restA, uint16_t fullA, uint16_t restB, uint16_t fullB)
 {
-	shDualClutchSensor.setCalibration(restA, fullA, restB, fullB);
+	shDualClutchSensor.setHostCalibration(restA, fullA, restB, fullB);
+}
+
+// Fired by SHCustomProtocol on every CRV: token; set() ignores an unchanged curve and
+// applies a new one at once. The EEPROM write happens later in taskPersist().
+void onCurveReceived(const uint16_t* knots)
+{
+	shDualClutchSensor.getCurve().set(knots);
 }
 
+#ifdef INCLUDE_WS2812B
+// Fired by SHCustomProtocol when the LB: brightness token changes.
+void onBrightnessReceived(uint8_t percent)
+{
+	shRGBLedsWS2812B.setBrightness(percent);
+}
+#endif
+
 void setup()
 {
 
@@ -176,6 +334,7 @@ void setup()
 #include "SHRGBLedsNeoPixel.h"
 	shRGBLedsWS2812B.begin(&WS2812B_strip, WS2812B_RGBLEDCOUNT, WS2812B_RIGHTTOLEFT, WS2812B_TESTMODE);
 #endif
+	shLedFx.begin(WS2812B_RGBLEDCOUNT);
 #endif
 
 	// Custom expanded inputs
@@ -186,11 +345,11 @@ void setup()
 
 	// Dual clutch sensors initialization (Hall effect on A4, A5)
 	shDualClutchSensor.begin();
-	// Apply compile-time calibration endpoints from hardwareSettings.h.
-	// These map raw SS49E ADC values to 0-1023. Measure your actual endpoints
-	// and update the defines in hardwareSettings.h, then reflash.
-	shDualClutchSensor.setCalibration(CLUTCH_A_CAL_REST, CLUTCH_A_CAL_FULL,
-																		CLUTCH_B_CAL_REST, CLUTCH_B_CAL_FULL);
+	// Endpoints captured on device (X clutchcal) if stored, else the compile-time
+	// calibration from hardwareSettings.h. These map raw SS49E ADC values to 0-1023.
+	if (!shDualClutchSensor.loadCalibration())
+		shDualClutchSensor.setCalibration(CLUTCH_A_CAL_REST, CLUTCH_A_CAL_FULL,
+																			CLUTCH_B_CAL_REST, CLUTCH_B_CAL_FULL);
 
 #ifdef INCLUDE_BUTTONS
 	// EXTERNAL BUTTONS INIT
@@ -208,13 +367,34 @@ void setup()
 	shCustomProtocol.setup();
 	shCustomProtocol.setClutchUpdateCallback(clutchSimHubUpdate);
 	shCustomProtocol.setCalibrationCallback(onCalibrationReceived);
-	arqserial.setIdleFunction(idle);
+	shCustomProtocol.setCurveCallback(onCurveReceived);
+#ifdef INCLUDE_WS2812B
+	shCustomProtocol.setBrightnessCallback(onBrightnessReceived);
+#endif
 
 	// Send initial rotary position now that inputs are initialized
 	// This ensures the plugin receives the rotary state right after boot
 	expandedInputs.readAll(expandedButtonChanged);
 	shCustomProtocol.setRotaryPosition(expandedInputs.getRotaryPosition());
 	// idle() handles the first send after SimHub connects (lastSentRotaryPos starts at -1)
+
+	// Scheduler tasks (serial control plane), in pass order.
+	// Deadlines are release lateness tolerated before X sched counts an overrun.
+	shScheduler.add(PSTR("events"), taskEvents, 0, 0);
+	shScheduler.add(PSTR("scan"), taskInputScan, 10, 5);
+	shScheduler.add(PSTR("telemetry"), taskTelemetry, SHCustomProtocol::TELEMETRY_INTERVAL, 50);
+	shScheduler.add(PSTR("stream"), taskClutchStream, 0, 0);
+#ifdef INCLUDE_WS2812B
+	shScheduler.add(PSTR("ledfx"), taskLedFx, LED_FX_FRAME_MS, LED_FX_FRAME_MS);
+#endif
+	shScheduler.add(PSTR("leds"), taskLedCommit, 0, 0);
+	shScheduler.add(PSTR("heartbeat"), taskHeartbeat, SHCustomProtocol::HEARTBEAT_INTERVAL, 1000);
+	shScheduler.add(PSTR("persist"), taskPersist, 100, 100);
+	// A task that did not fit (SCHEDULER_MAX_TASKS) would never run: shows as REJ in X sched.
+	arqserial.setIdleFunction(idle);
+
+	// Input plane last: from here on the Timer2 tick owns the ADC and the SR chain.
+	shInputPlane.begin(inputPlaneClutchSample, inputPlaneTick);
 }
 
 #if ENABLED_ENCODERS_COUNT > 0
@@ -252,7 +432,7 @@ void loop()
 	{
 		if (FlowSerialTimedRead() == MESSAGE_HEADER)
 		{
-			lastSerialActivity = millis();
+			lastSerialActivity = shScheduler.now();
 			// Read command
 			loop_opt = FlowSerialTimedRead();
 
@@ -298,30 +478,75 @@ void loop()
 				Command_CustomProtocolData();
 			else if (loop_opt == 'X')
 			{
-				String xaction = FlowSerialReadStringUntil(' ', '\n');
-				if (xaction == F("list"))
+				char xaction[16];
+				FlowSerialReadStringUntil(xaction, sizeof(xaction), ' ', '\n');
+				if (!strcmp_P(xaction, PSTR("list")))
 					Command_ExpandedCommandsList();
-				else if (xaction == F("mcutype"))
+				else if (!strcmp_P(xaction, PSTR("mcutype")))
 					Command_MCUType();
-				else if (xaction == F("tach"))
+				else if (!strcmp_P(xaction, PSTR("tach")))
 					Command_TachData();
-				else if (xaction == F("speedo"))
+				else if (!strcmp_P(xaction, PSTR("speedo")))
 					Command_SpeedoData();
-				else if (xaction == F("boost"))
+				else if (!strcmp_P(xaction, PSTR("boost")))
 					Command_BoostData();
-				else if (xaction == F("temp"))
+				else if (!strcmp_P(xaction, PSTR("temp")))
 					Command_TempData();
-				else if (xaction == F("fuel"))
+				else if (!strcmp_P(xaction, PSTR("fuel")))
 					Command_FuelData();
-				else if (xaction == F("cons"))
+				else if (!strcmp_P(xaction, PSTR("cons")))
 					Command_ConsData();
-				else if (xaction == F("encoderscount"))
+				else if (!strcmp_P(xaction, PSTR("encoderscount")))
 					Command_EncodersCount();
+				else if (!strcmp_P(xaction, PSTR("route")))
+					Command_RoutingTable();
+				else if (!strcmp_P(xaction, PSTR("ladder")))
+					Command_LadderDump();
+				else if (!strcmp_P(xaction, PSTR("ladderreset")))
+					Command_LadderReset();
+				else if (!strcmp_P(xaction, PSTR("sched")))
+					Command_SchedulerStats();
+				else if (!strcmp_P(xaction, PSTR("clutchbench")))
+					Command_ClutchBench();
+				else if (!strcmp_P(xaction, PSTR("clutchfilter")))
+					Command_ClutchFilter();
+				else if (!strcmp_P(xaction, PSTR("clutchprofile")))
+					Command_ClutchProfile();
+				else if (!strcmp_P(xaction, PSTR("clutchcurve")))
+					Command_ClutchCurve();
+				else if (!strcmp_P(xaction, PSTR("clutchstream")))
+					Command_ClutchStream();
+				else if (!strcmp_P(xaction, PSTR("clutchcal")))
+					Command_ClutchCal();
+				else if (!strcmp_P(xaction, PSTR("clutchcalstate")))
+					Command_ClutchCalState();
+				else if (!strcmp_P(xaction, PSTR("launch")))
+					Command_Launch();
+				else if (!strcmp_P(xaction, PSTR("launchcfg")))
+					Command_LaunchConfig();
+				else if (!strcmp_P(xaction, PSTR("linkstats")))
+					Command_LinkStats();
+				else if (!strcmp_P(xaction, PSTR("mem")))
+					Command_Mem();
+#ifdef INCLUDE_WS2812B
+				else if (!strcmp_P(xaction, PSTR("ledfx")))
+					Command_LedFx();
+				else if (!strcmp_P(xaction, PSTR("ledfxcfg")))
+					Command_LedFxConfig();
+#endif
+#if CLUTCH_DITHER_BITS > 0
+				else if (!strcmp_P(xaction, PSTR("clutchdither")))
+					Command_ClutchDither();
+#endif
+#if CLUTCH_LATENCY_PROBE
+				else if (!strcmp_P(xaction, PSTR("clutchlat")))
+					Command_ClutchLatency();
+#endif
 			}
 		}
 	}
 
-	if (millis() - lastSerialActivity > 5000)
+	if (shScheduler.now() - lastSerialActivity > 5000)
 	{
 		Command_Shutdown();
 	}